@@ -0,0 +1,87 @@
+#include "AgentStore.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AGENT_STORE_SSE
+#include <emmintrin.h>
+#endif
+
+size_t AgentStore::add(float agentX, float agentZ, float angle, int agentColor, Transform* move, Transform* face, Particle* effect) {
+	x.push_back(agentX);
+	z.push_back(agentZ);
+	heading.push_back(angle);
+	dirX.push_back(glm::sin(angle));
+	dirZ.push_back(glm::cos(angle));
+	// new astros stand still until they are toggled
+	speed.push_back(0.0f);
+	color.push_back(agentColor);
+	moveNode.push_back(move);
+	faceNode.push_back(face);
+	particle.push_back(effect);
+	return x.size() - 1;
+}
+
+void AgentStore::remove(size_t i) {
+	size_t last = x.size() - 1;
+	x[i] = x[last];
+	z[i] = z[last];
+	heading[i] = heading[last];
+	dirX[i] = dirX[last];
+	dirZ[i] = dirZ[last];
+	speed[i] = speed[last];
+	color[i] = color[last];
+	moveNode[i] = moveNode[last];
+	faceNode[i] = faceNode[last];
+	particle[i] = particle[last];
+
+	x.pop_back();
+	z.pop_back();
+	heading.pop_back();
+	dirX.pop_back();
+	dirZ.pop_back();
+	speed.pop_back();
+	color.pop_back();
+	moveNode.pop_back();
+	faceNode.pop_back();
+	particle.pop_back();
+}
+
+void AgentStore::clear() {
+	x.clear();
+	z.clear();
+	heading.clear();
+	dirX.clear();
+	dirZ.clear();
+	speed.clear();
+	color.clear();
+	moveNode.clear();
+	faceNode.clear();
+	particle.clear();
+}
+
+void AgentStore::setHeading(size_t i, float angle) {
+	heading[i] = angle;
+	dirX[i] = glm::sin(angle);
+	dirZ[i] = glm::cos(angle);
+}
+
+void AgentStore::integrate(size_t begin, size_t end) {
+	size_t i = begin;
+
+#ifdef AGENT_STORE_SSE
+	// four agents per iteration
+	for (; i + 4 <= end; i += 4) {
+		__m128 agentSpeed = _mm_loadu_ps(&speed[i]);
+		__m128 agentX = _mm_loadu_ps(&x[i]);
+		__m128 agentZ = _mm_loadu_ps(&z[i]);
+		agentX = _mm_add_ps(agentX, _mm_mul_ps(agentSpeed, _mm_loadu_ps(&dirX[i])));
+		agentZ = _mm_add_ps(agentZ, _mm_mul_ps(agentSpeed, _mm_loadu_ps(&dirZ[i])));
+		_mm_storeu_ps(&x[i], agentX);
+		_mm_storeu_ps(&z[i], agentZ);
+	}
+#endif
+
+	// remaining agents, or all of them without SSE
+	for (; i < end; ++i) {
+		step(i);
+	}
+}
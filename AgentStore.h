@@ -0,0 +1,41 @@
+#ifndef _AGENT_STORE_H_
+#define _AGENT_STORE_H_
+
+#include "Transform.h"
+#include "Particle.h"
+#include <vector>
+
+// Computer astro state as structure of arrays. Every array is indexed by agent,
+// the simulation works on the contiguous float arrays and the scene graph nodes
+// are only written back once per tick.
+class AgentStore
+{
+public:
+	std::vector<float> x;
+	std::vector<float> z;
+	std::vector<float> heading;
+	// sin/cos of heading, so the movement kernel needs no trig
+	std::vector<float> dirX;
+	std::vector<float> dirZ;
+	std::vector<float> speed;
+	std::vector<int> color;
+	std::vector<Transform*> moveNode;
+	std::vector<Transform*> faceNode;
+	std::vector<Particle*> particle;
+
+	size_t size() const { return x.size(); }
+	size_t add(float x, float z, float heading, int color, Transform* moveNode, Transform* faceNode, Particle* particle);
+	// swap the last agent into slot i, so removal is O(1) but reorders agents
+	void remove(size_t i);
+	void clear();
+	void setHeading(size_t i, float angle);
+	// move agents [begin, end) along their heading by their speed
+	void integrate(size_t begin, size_t end);
+	// move one agent along its heading by its speed
+	void step(size_t i) {
+		x[i] += speed[i] * dirX[i];
+		z[i] += speed[i] * dirZ[i];
+	}
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "AssetLoader.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "Scene.h"
+
+std::vector<std::thread> AssetLoader::workers;
+std::mutex AssetLoader::mutex;
+std::condition_variable AssetLoader::wake;
+std::condition_variable AssetLoader::done;
+std::deque<AssetLoader::Job> AssetLoader::requests;
+std::deque<AssetLoader::Job> AssetLoader::completed;
+size_t AssetLoader::pending = 0;
+bool AssetLoader::stopping = false;
+
+double AssetLoader::uploadBudgetMs = 2.0;
+
+void AssetLoader::start(unsigned threadCount) {
+	if (!workers.empty()) {
+		return;
+	}
+	stopping = false;
+	for (unsigned i = 0; i < threadCount; ++i) {
+		workers.emplace_back(work);
+	}
+}
+
+void AssetLoader::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		requests.clear();
+	}
+	wake.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+	completed.clear();
+	pending = 0;
+}
+
+void AssetLoader::work() {
+	Profiler::setThreadName("asset loader");
+	for (;;) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [] { return stopping || !requests.empty(); });
+			if (stopping) {
+				return;
+			}
+			job = std::move(requests.front());
+			requests.pop_front();
+		}
+
+		// file I/O, parsing and building only, GL calls stay on the main thread
+		{
+			PROFILE_SCOPE("AssetLoader::load");
+			job.file = std::make_unique<MeshFile>();
+			if (!job.file->load(job.mesh->getFilename())) {
+				job.file.reset();
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (stopping) {
+				return;
+			}
+			completed.push_back(std::move(job));
+		}
+		done.notify_all();
+	}
+}
+
+void AssetLoader::finish(Job& job) {
+	if (job.file) {
+		job.mesh->upload(*job.file);
+	}
+	else {
+		LOG_WARNING("Can't load the mesh: %s", job.mesh->getFilename().c_str());
+	}
+}
+
+void AssetLoader::load(const std::shared_ptr<Mesh>& mesh) {
+	if (workers.empty()) {
+		Job job;
+		job.mesh = mesh;
+		job.file = std::make_unique<MeshFile>();
+		if (!job.file->load(mesh->getFilename())) {
+			job.file.reset();
+		}
+		finish(job);
+		Scene::structureChanged();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Job job;
+		job.mesh = mesh;
+		requests.push_back(std::move(job));
+		++pending;
+	}
+	wake.notify_one();
+}
+
+size_t AssetLoader::pump() {
+	PROFILE_SCOPE("AssetLoader::pump");
+	size_t uploaded = upload((uint64_t)(uploadBudgetMs * 1e6));
+	Profiler::counter("assets pending", (double)pendingCount());
+	return uploaded;
+}
+
+size_t AssetLoader::upload(uint64_t budget) {
+	uint64_t start = Profiler::now();
+	size_t uploaded = 0;
+	for (;;) {
+		Job job;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (completed.empty()) {
+				break;
+			}
+			job = std::move(completed.front());
+			completed.pop_front();
+			--pending;
+		}
+		finish(job);
+		++uploaded;
+		// the rest waits for the next frame
+		if (Profiler::now() - start >= budget) {
+			break;
+		}
+	}
+
+	// geometries of the new meshes get their bounds when the scene is flattened again
+	if (uploaded > 0) {
+		Scene::structureChanged();
+	}
+	return uploaded;
+}
+
+void AssetLoader::waitAll() {
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [] { return pending == 0 || !completed.empty(); });
+			if (pending == 0) {
+				return;
+			}
+		}
+		upload(UINT64_MAX);
+	}
+}
+
+size_t AssetLoader::pendingCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return pending;
+}
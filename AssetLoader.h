@@ -0,0 +1,62 @@
+#ifndef _ASSET_LOADER_H_
+#define _ASSET_LOADER_H_
+
+#include "Mesh.h"
+#include "MeshFile.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+// Reads and builds mesh files on worker threads and uploads them on the main
+// thread. MeshCache hands out a Mesh right away and queues it here; a worker
+// maps the cache or parses the OBJ into a MeshFile and posts it back, and
+// pump() creates the GL buffers of finished meshes until the frame's upload
+// budget is spent. A Mesh stays invalid (and is skipped when drawn) until it
+// is resident. Without workers a mesh is loaded and uploaded on the spot.
+class AssetLoader
+{
+private:
+	struct Job {
+		std::shared_ptr<Mesh> mesh;
+		// null when loading failed
+		std::unique_ptr<MeshFile> file;
+	};
+
+	static std::vector<std::thread> workers;
+	static std::mutex mutex;
+	static std::condition_variable wake;
+	// condition of the completed queue, for waitAll
+	static std::condition_variable done;
+	static std::deque<Job> requests;
+	static std::deque<Job> completed;
+	// requested but not uploaded yet
+	static size_t pending;
+	static bool stopping;
+
+	static void work();
+	static void finish(Job& job);
+	// upload finished meshes for up to budget nanoseconds
+	static size_t upload(uint64_t budget);
+
+public:
+	// milliseconds pump spends on uploads per frame, at least one upload always runs
+	static double uploadBudgetMs;
+
+	static void start(unsigned threadCount);
+	// drop everything not uploaded yet and join the workers, before the GL context goes away
+	static void stop();
+
+	// load the mesh's file in the background
+	static void load(const std::shared_ptr<Mesh>& mesh);
+	// upload finished meshes within the budget, returns how many became resident
+	static size_t pump();
+	// block until every requested mesh is resident or failed, for start up
+	static void waitAll();
+	static size_t pendingCount();
+};
+
+#endif
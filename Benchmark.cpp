@@ -0,0 +1,348 @@
+#include "Benchmark.h"
+#include "Window.h"
+#include "Hash.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+	void usage(const char* program) {
+		std::cerr << "Usage: " << program << " [--headless] [--ticks N] [--agents N] [--particles N] [--seed N] [--trace FILE] [--log FILE] [--record FILE] [--replay FILE] [--threads N] [--scaling] [--verbose]" << std::endl;
+	}
+
+	void appendMatrix(std::vector<float>& state, const glm::mat4& matrix) {
+		for (int column = 0; column < 4; ++column) {
+			for (int row = 0; row < 4; ++row) {
+				state.push_back(matrix[column][row]);
+			}
+		}
+	}
+
+	// where every astro ended up, equal for a replay and its recording. The
+	// world matrices of the deepest transforms cover the scene's world pass.
+	uint64_t stateHash() {
+		const AgentStore& agents = Window::agents;
+		std::vector<float> state;
+		for (size_t i = 0; i < agents.size(); ++i) {
+			state.insert(state.end(), { agents.x[i], agents.z[i], agents.heading[i], agents.speed[i] });
+			appendMatrix(state, agents.faceNode[i]->getWorld());
+		}
+		glm::vec3 player = Window::playerAstroMoveControl->getLocation();
+		state.insert(state.end(), { player.x, player.z });
+		appendMatrix(state, Window::playerAstroFaceControl->getWorld());
+		return hashBytes((const char*)state.data(), state.size() * sizeof(float));
+	}
+
+	// what one pass of the benchmark measured
+	struct RunResult {
+		double populateSeconds;
+		double seconds;
+		uint64_t hash;
+	};
+
+	// fill the lobby and run the ticks on objects set up by initializeObjects
+	void simulate(const BenchmarkConfig& config, RunResult& result) {
+		// start from a full crowd; past ~150 astros the lobby is saturated and new
+		// ones are placed overlapping, so large counts measure the dense case
+		auto start = std::chrono::steady_clock::now();
+		bool populate = !InputRecorder::isReplaying() || InputRecorder::replayHeader().populated;
+		while (populate && Window::agents.size() < config.agents) {
+			// refresh the broad phase each time the crowd doubles so spawns mostly avoid each other
+			size_t count = Window::agents.size();
+			if ((count & (count - 1)) == 0) {
+				Window::buildAstroGrid();
+			}
+			Window::randomAdd(true);
+		}
+		result.populateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// every tick counts as a frame of the trace
+		if (!config.trace.empty()) {
+			Profiler::captureTrace(config.trace, config.ticks);
+		}
+
+		Window::tickTimings = TickTimings();
+		start = std::chrono::steady_clock::now();
+		for (unsigned tick = 0; tick < config.ticks; ++tick) {
+			Window::idleCallback();
+			Profiler::endFrame();
+		}
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		result.hash = stateHash();
+	}
+
+	// one line of the phase table
+	void printPhase(const char* name, double seconds, double total, unsigned ticks) {
+		std::cout << "  " << std::left << std::setw(14) << name << std::right
+			<< std::setw(10) << seconds * 1000.0 / ticks << " ms/tick"
+			<< std::setw(8) << (total > 0 ? seconds / total * 100.0 : 0.0) << "%" << std::endl;
+	}
+}
+
+bool Benchmark::parseArgs(int argc, char* argv[], BenchmarkConfig& config) {
+	config.headless = false;
+	config.verbose = false;
+	config.scaling = false;
+	config.threads = Window::jobThreads;
+	config.ticks = 1000;
+	config.agents = Window::maxComputerAstros;
+	config.particles = Window::particleCount;
+	config.seed = Window::seed;
+	config.trace.clear();
+	config.log.clear();
+	config.record.clear();
+	config.replay.clear();
+
+	for (int i = 1; i < argc; ++i) {
+		std::string option = argv[i];
+		if (option == "--headless") {
+			config.headless = true;
+			continue;
+		}
+		if (option == "--verbose") {
+			config.verbose = true;
+			continue;
+		}
+		if (option == "--scaling") {
+			config.scaling = true;
+			continue;
+		}
+
+		if (i + 1 >= argc) {
+			std::cerr << "Missing value for " << option << std::endl;
+			usage(argv[0]);
+			return false;
+		}
+		if (option == "--trace") {
+			config.trace = argv[++i];
+			continue;
+		}
+		if (option == "--log") {
+			config.log = argv[++i];
+			continue;
+		}
+		if (option == "--record") {
+			config.record = argv[++i];
+			continue;
+		}
+		if (option == "--replay") {
+			config.replay = argv[++i];
+			continue;
+		}
+
+		// everything else takes a non-negative number
+		char* end;
+		unsigned long long value = strtoull(argv[++i], &end, 10);
+		if (*end != '\0' || argv[i][0] == '-') {
+			std::cerr << "Invalid value for " << option << ": " << argv[i] << std::endl;
+			usage(argv[0]);
+			return false;
+		}
+
+		if (option == "--ticks") {
+			config.ticks = (unsigned)value;
+		}
+		else if (option == "--agents") {
+			config.agents = (size_t)value;
+		}
+		else if (option == "--particles") {
+			config.particles = (int)value;
+		}
+		else if (option == "--seed") {
+			config.seed = (unsigned)value;
+		}
+		else if (option == "--threads") {
+			config.threads = (unsigned)value;
+		}
+		else {
+			std::cerr << "Unknown option " << option << std::endl;
+			usage(argv[0]);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Benchmark::startSession(BenchmarkConfig& config) {
+	if (!config.record.empty() && !config.replay.empty()) {
+		std::cerr << "Can't record and replay at once" << std::endl;
+		return false;
+	}
+	if (config.scaling && (!config.headless || !config.record.empty() || !config.replay.empty())) {
+		std::cerr << "--scaling only runs headless, without a recording" << std::endl;
+		return false;
+	}
+	if (!config.record.empty()) {
+		return InputRecorder::startRecording(config.record, config.seed, (uint32_t)config.agents, (uint32_t)config.particles,
+			config.headless, Transform::tick);
+	}
+	if (config.replay.empty()) {
+		return true;
+	}
+
+	if (!InputRecorder::startReplay(config.replay, Transform::tick)) {
+		return false;
+	}
+	const RecordingHeader& header = InputRecorder::replayHeader();
+	// a windowed session starts with an empty lobby, only headless runs can leave out the fill
+	if (header.populated && !config.headless) {
+		std::cerr << "Recorded headless, replay it with --headless" << std::endl;
+		return false;
+	}
+	config.seed = header.seed;
+	config.agents = header.agents;
+	config.particles = (int)header.particles;
+	config.ticks = header.ticks;
+	return true;
+}
+
+void Benchmark::apply(const BenchmarkConfig& config) {
+	Window::maxComputerAstros = config.agents;
+	Window::particleCount = config.particles;
+	Window::seed = config.seed;
+	Window::headless = config.headless;
+	Window::jobThreads = config.threads;
+}
+
+int Benchmark::run(const BenchmarkConfig& config) {
+	if (config.scaling) {
+		return runScaling(config);
+	}
+
+	apply(config);
+	if (!Window::initializeObjects()) {
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Headless run: " << config.ticks << " ticks, " << config.agents << " agents, "
+		<< config.particles << " particles each, seed " << config.seed << ", "
+		<< JobSystem::threadCount() << " threads" << std::endl;
+
+	// only problems are logged during the run unless asked for everything
+	if (!config.verbose) {
+		Log::setLevel(LogLevel::Warning);
+	}
+
+	RunResult result;
+	simulate(config, result);
+	double seconds = result.seconds;
+	InputRecorder::stopRecording(Transform::tick);
+
+	Log::setLevel(LogLevel::Debug);
+
+	const TickTimings& timings = Window::tickTimings;
+	unsigned ticks = config.ticks > 0 ? config.ticks : 1;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Populated " << config.agents << " agents in " << result.populateSeconds * 1000.0 << " ms" << std::endl;
+	std::cout << "Ran " << config.ticks << " ticks in " << seconds << " s ("
+		<< std::setprecision(1) << (seconds > 0 ? config.ticks / seconds : 0.0) << " ticks/s), "
+		<< Window::agents.size() << " agents at the end" << std::endl;
+	std::cout << "State hash: " << std::hex << result.hash << std::dec << std::endl;
+	std::cout << std::setprecision(4);
+	printPhase("movement", timings.movement, seconds, ticks);
+	printPhase("collision", timings.collision, seconds, ticks);
+	printPhase("spawn/remove", timings.spawn, seconds, ticks);
+	printPhase("scene update", timings.scene, seconds, ticks);
+	std::cout << std::setprecision(1) << "Peak memory: " << peakMemory() / (1024.0 * 1024.0) << " MB" << std::endl;
+	ParticlePoolStats pool = ParticlePool::stats();
+	std::cout << "Particle pool: " << pool.inUse << "/" << pool.slots << " slots in use, high water "
+		<< pool.highWater << ", " << pool.acquired << " acquired, " << pool.failed << " found it full" << std::endl;
+	if (!config.trace.empty()) {
+		std::cout << "Trace written to " << config.trace << std::endl;
+	}
+
+	Window::cleanUp();
+	return EXIT_SUCCESS;
+}
+
+int Benchmark::runScaling(const BenchmarkConfig& config) {
+	unsigned maxThreads = config.threads > 0 ? config.threads : std::thread::hardware_concurrency();
+	if (maxThreads == 0) {
+		maxThreads = 1;
+	}
+	std::vector<unsigned> threadCounts;
+	for (unsigned threads = 1; threads < maxThreads; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	std::cout << "Scaling run: " << config.ticks << " ticks, " << config.agents << " agents, "
+		<< config.particles << " particles each, seed " << config.seed << std::endl;
+	std::cout << "Covers movement, collision, particle clocks and world matrices; headless has no geometry, so no culling bounds" << std::endl;
+	if (!config.verbose) {
+		Log::setLevel(LogLevel::Warning);
+	}
+
+	// every pass starts over from the same seed, only the thread count changes
+	std::cout << std::fixed << "  threads   ticks/s   speedup   state hash" << std::endl;
+	double serialSeconds = 0;
+	uint64_t serialHash = 0;
+	bool deterministic = true;
+	for (unsigned threads : threadCounts) {
+		BenchmarkConfig pass = config;
+		pass.threads = threads;
+		pass.trace.clear();
+		apply(pass);
+		if (!Window::initializeObjects()) {
+			return EXIT_FAILURE;
+		}
+
+		RunResult result;
+		simulate(pass, result);
+		Window::cleanUp();
+
+		if (threads == 1) {
+			serialSeconds = result.seconds;
+			serialHash = result.hash;
+		}
+		deterministic = deterministic && result.hash == serialHash;
+		std::cout << std::setw(9) << threads
+			<< std::setw(10) << std::setprecision(1) << (result.seconds > 0 ? config.ticks / result.seconds : 0.0)
+			<< std::setw(9) << std::setprecision(2) << (result.seconds > 0 ? serialSeconds / result.seconds : 0.0) << "x"
+			<< "   " << std::hex << result.hash << std::dec << std::endl;
+	}
+	Log::setLevel(LogLevel::Debug);
+
+	if (!deterministic) {
+		std::cerr << "The state differs between thread counts" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "Every thread count ended in the same state" << std::endl;
+	return EXIT_SUCCESS;
+}
+
+size_t Benchmark::peakMemory() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return 0;
+	}
+	return (size_t)counters.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#ifdef __APPLE__
+	// bytes on macOS
+	return (size_t)usage.ru_maxrss;
+#else
+	// kilobytes on Linux
+	return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
@@ -0,0 +1,51 @@
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include <stddef.h>
+#include <string>
+
+// command line options, e.g.
+// --headless --ticks 1000 --agents 10000 --particles 150 --seed 1 --trace bench.json --log run.log
+// --record session.rec / --replay session.rec
+// --threads 4 / --headless --scaling
+struct BenchmarkConfig {
+	bool headless;
+	bool verbose;
+	// run headless once per thread count and compare, up to threads
+	bool scaling;
+	// threads the simulation and scene use, 0 for one per core
+	unsigned threads;
+	unsigned ticks;
+	size_t agents;
+	int particles;
+	unsigned seed;
+	// Chrome trace of the whole headless run, empty for none
+	std::string trace;
+	// file the log is written to, empty for stderr
+	std::string log;
+	// input recording to write or to play back, empty for none
+	std::string record;
+	std::string replay;
+};
+
+// Runs the simulation without a window or GL context for a fixed number of
+// ticks and prints throughput, time per phase and peak memory.
+class Benchmark
+{
+public:
+	// false (with a message) on unknown or malformed options
+	static bool parseArgs(int argc, char* argv[], BenchmarkConfig& config);
+	// start recording, or load a replay and take its seed, agents, particles
+	// and length over into config
+	static bool startSession(BenchmarkConfig& config);
+	// copy the options shared with the windowed mode into Window
+	static void apply(const BenchmarkConfig& config);
+	static int run(const BenchmarkConfig& config);
+	// run with 1, 2, 4, ... threads, print the speedup over one thread and
+	// check every thread count ends in the same state
+	static int runScaling(const BenchmarkConfig& config);
+	// peak resident set size of the process in bytes, 0 if unknown
+	static size_t peakMemory();
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include "CollisionWorld.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+void CollisionWorld::addSegment(const glm::vec2& a, const glm::vec2& b) {
+	colliders.push_back(Collider{ a, b, 0.0f, false });
+}
+
+void CollisionWorld::addCircle(const glm::vec2& center, float radius) {
+	colliders.push_back(Collider{ center, center, radius, true });
+}
+
+bool CollisionWorld::load(const std::string& filename) {
+	std::ifstream in(filename);
+	if (!in.is_open()) {
+		std::cerr << "Can't open colliders: " << filename << std::endl;
+		return false;
+	}
+
+	colliders.clear();
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(in, line)) {
+		++lineNumber;
+		line = line.substr(0, line.find('#'));
+		std::istringstream fields(line);
+		std::string kind;
+		if (!(fields >> kind)) {
+			continue;
+		}
+
+		float x0, z0, x1, z1, radius;
+		if (kind == "segment" && fields >> x0 >> z0 >> x1 >> z1) {
+			addSegment(glm::vec2(x0, z0), glm::vec2(x1, z1));
+		}
+		else if (kind == "circle" && fields >> x0 >> z0 >> radius) {
+			addCircle(glm::vec2(x0, z0), radius);
+		}
+		else {
+			std::cerr << filename << ":" << lineNumber << ": bad collider: " << line << std::endl;
+			return false;
+		}
+	}
+	finalize();
+	return true;
+}
+
+glm::vec2 CollisionWorld::colliderMin(const Collider& collider) const {
+	return glm::min(collider.a, collider.b) - glm::vec2(collider.radius);
+}
+
+glm::vec2 CollisionWorld::colliderMax(const Collider& collider) const {
+	return glm::max(collider.a, collider.b) + glm::vec2(collider.radius);
+}
+
+void CollisionWorld::finalize() {
+	nodes.clear();
+	if (!colliders.empty()) {
+		build(0, (uint32_t)colliders.size());
+	}
+}
+
+void CollisionWorld::build(uint32_t first, uint32_t count) {
+	uint32_t index = (uint32_t)nodes.size();
+	nodes.push_back(Node{ colliderMin(colliders[first]), colliderMax(colliders[first]), 0, first, 0 });
+	for (uint32_t i = first + 1; i < first + count; ++i) {
+		nodes[index].boxMin = glm::min(nodes[index].boxMin, colliderMin(colliders[i]));
+		nodes[index].boxMax = glm::max(nodes[index].boxMax, colliderMax(colliders[i]));
+	}
+	if (count <= leafSize) {
+		nodes[index].count = count;
+		return;
+	}
+
+	// split at the median center along the longer side of the box
+	glm::vec2 extent = nodes[index].boxMax - nodes[index].boxMin;
+	int axis = extent.x >= extent.y ? 0 : 1;
+	uint32_t half = count / 2;
+	std::nth_element(colliders.begin() + first, colliders.begin() + first + half, colliders.begin() + first + count,
+		[axis](const Collider& a, const Collider& b) {
+			return (a.a[axis] + a.b[axis]) < (b.a[axis] + b.b[axis]);
+		});
+
+	build(first, half);
+	nodes[index].right = (uint32_t)nodes.size();
+	build(first + half, count - half);
+}
+
+Contact CollisionWorld::collide(const glm::vec2& center, float radius) const {
+	Contact contact = { false, glm::vec2(0), 0.0f };
+	if (nodes.empty()) {
+		return contact;
+	}
+
+	glm::vec2 queryMin = center - glm::vec2(radius);
+	glm::vec2 queryMax = center + glm::vec2(radius);
+	glm::vec2 normalSum(0);
+
+	// the tree is balanced, 32 levels are far more than any lobby needs
+	uint32_t stack[32];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		uint32_t index = stack[--top];
+		const Node& node = nodes[index];
+		if (glm::any(glm::lessThan(node.boxMax, queryMin)) || glm::any(glm::greaterThan(node.boxMin, queryMax))) {
+			continue;
+		}
+		if (node.count == 0) {
+			stack[top++] = node.right;
+			stack[top++] = index + 1;
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+			const Collider& collider = colliders[i];
+			// closest point of the collider's core, a circle's center or a point on the segment
+			glm::vec2 closest = collider.a;
+			if (!collider.isCircle) {
+				glm::vec2 along = collider.b - collider.a;
+				float length2 = glm::dot(along, along);
+				float t = length2 > 0 ? glm::clamp(glm::dot(center - collider.a, along) / length2, 0.0f, 1.0f) : 0.0f;
+				closest = collider.a + along * t;
+			}
+			glm::vec2 offset = center - closest;
+			float distance = glm::length(offset);
+			float depth = radius + collider.radius - distance;
+			if (depth < 0 || distance == 0) {
+				continue;
+			}
+			normalSum += offset / distance;
+			contact.depth = contact.hit ? glm::max(contact.depth, depth) : depth;
+			contact.hit = true;
+		}
+	}
+
+	// walls meeting at a corner push out along both of their normals
+	if (contact.hit) {
+		float length = glm::length(normalSum);
+		contact.normal = length > 0 ? normalSum / length : glm::vec2(0);
+	}
+	return contact;
+}
+
+void CollisionWorld::collide(const float* x, const float* z, size_t count, float radius, Contact* contacts) const {
+	for (size_t i = 0; i < count; ++i) {
+		contacts[i] = collide(glm::vec2(x[i], z[i]), radius);
+	}
+}
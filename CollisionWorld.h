@@ -0,0 +1,68 @@
+#ifndef _COLLISION_WORLD_H_
+#define _COLLISION_WORLD_H_
+
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// what a circle touching the world found, normal points from the world
+// towards the circle
+struct Contact {
+	bool hit;
+	glm::vec2 normal;
+	// how far the circle reaches into the deepest collider
+	float depth;
+};
+
+// Static colliders on the xz plane, segments (walls) and circles (props),
+// loaded once and kept in a bounding volume hierarchy. Queries test a circle
+// against every collider it overlaps and merge the contacts into one normal,
+// so corners push out diagonally instead of by whichever wall was tested
+// first. Queries don't allocate and don't print.
+class CollisionWorld
+{
+private:
+	struct Collider {
+		// segment from a to b, or circle around a when isCircle
+		glm::vec2 a, b;
+		float radius;
+		bool isCircle;
+	};
+
+	// depth first order, an inner node's first child directly follows it
+	struct Node {
+		glm::vec2 boxMin, boxMax;
+		// second child of an inner node
+		uint32_t right;
+		// colliders [first, first + count) of a leaf, count is 0 for inner nodes
+		uint32_t first;
+		uint32_t count;
+	};
+
+	std::vector<Collider> colliders;
+	std::vector<Node> nodes;
+
+	void build(uint32_t first, uint32_t count);
+	glm::vec2 colliderMin(const Collider& collider) const;
+	glm::vec2 colliderMax(const Collider& collider) const;
+
+public:
+	// colliders per leaf
+	static const uint32_t leafSize = 2;
+
+	void addSegment(const glm::vec2& a, const glm::vec2& b);
+	void addCircle(const glm::vec2& center, float radius);
+	// replace the colliders with the "segment x0 z0 x1 z1" and "circle x z
+	// radius" lines of a file, # starts a comment
+	bool load(const std::string& filename);
+	// build the hierarchy, after adding colliders
+	void finalize();
+	size_t size() const { return colliders.size(); }
+
+	Contact collide(const glm::vec2& center, float radius) const;
+	// one contact per circle, for every agent at once
+	void collide(const float* x, const float* z, size_t count, float radius, Contact* contacts) const;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "FrameUniforms.h"
+
+GLuint FrameUniforms::buffer = 0;
+const char* const FrameUniforms::blockName = "FrameData";
+
+void FrameUniforms::init() {
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// stays bound for the lifetime of the program
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer);
+}
+
+void FrameUniforms::update(const glm::mat4& view, const glm::mat4& projection,
+	const glm::vec3& eyePos, const glm::vec3& lightPos, const glm::vec3& lightColor) {
+	FrameData data;
+	data.view = view;
+	data.projection = projection;
+	data.eyePos = eyePos;
+	data.padding0 = 0;
+	data.lightPos = lightPos;
+	data.padding1 = 0;
+	data.lightColor = lightColor;
+	data.padding2 = 0;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FrameUniforms::cleanUp() {
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
@@ -0,0 +1,41 @@
+#ifndef _FRAME_UNIFORMS_H_
+#define _FRAME_UNIFORMS_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+
+#include <glm/glm.hpp>
+
+// std140 layout of the FrameData block declared in every shader
+struct FrameData {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 eyePos;
+	float padding0;
+	glm::vec3 lightPos;
+	float padding1;
+	glm::vec3 lightColor;
+	float padding2;
+};
+
+// Camera and light data shared by all programs through one uniform buffer,
+// uploaded once per frame instead of once per program.
+class FrameUniforms
+{
+private:
+	static GLuint buffer;
+
+public:
+	static const GLuint bindingPoint = 0;
+	static const char* const blockName;
+
+	static void init();
+	static void update(const glm::mat4& view, const glm::mat4& projection,
+		const glm::vec3& eyePos, const glm::vec3& lightPos, const glm::vec3& lightColor);
+	static void cleanUp();
+};
+
+#endif
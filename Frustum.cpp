@@ -0,0 +1,121 @@
+#include "Frustum.h"
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+void CullBounds::resize(size_t size) {
+	count = size;
+	size_t padded = (size + 3) & ~(size_t)3;
+	for (auto array : { &x, &y, &z, &radius, &extentX, &extentY, &extentZ, &scale }) {
+		array->assign(padded, 0.0f);
+	}
+}
+
+void CullBounds::set(size_t i, const glm::mat4& world, const glm::vec3& boxMin, const glm::vec3& boxMax, float sphereRadius) {
+	glm::vec3 center = (boxMin + boxMax) * 0.5f;
+	glm::vec3 extent = (boxMax - boxMin) * 0.5f;
+
+	// box center moves with the matrix, the extent grows by the absolute rotation (Arvo)
+	glm::vec3 worldCenter = glm::vec3(world * glm::vec4(center, 1));
+	glm::vec3 worldExtent(0);
+	float maxScale = 0;
+	for (int column = 0; column < 3; ++column) {
+		glm::vec3 axis = glm::vec3(world[column]);
+		worldExtent += glm::abs(axis) * extent[column];
+		maxScale = glm::max(maxScale, glm::length(axis));
+	}
+	x[i] = worldCenter.x;
+	y[i] = worldCenter.y;
+	z[i] = worldCenter.z;
+	extentX[i] = worldExtent.x;
+	extentY[i] = worldExtent.y;
+	extentZ[i] = worldExtent.z;
+
+	// the sphere is around the model origin, keep it centered on the box
+	glm::vec3 offset = glm::vec3(world * glm::vec4(0, 0, 0, 1)) - worldCenter;
+	radius[i] = sphereRadius * maxScale + glm::length(offset);
+	scale[i] = maxScale;
+}
+
+Frustum::Frustum() {
+	for (auto& plane : planes) {
+		plane = glm::vec4(0, 0, 0, 1);
+	}
+}
+
+void Frustum::extract(const glm::mat4& viewProjection) {
+	// Gribb-Hartmann, rows of the matrix added to and subtracted from the last one
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i) {
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+	for (int i = 0; i < 3; ++i) {
+		planes[i * 2] = rows[3] + rows[i];
+		planes[i * 2 + 1] = rows[3] - rows[i];
+	}
+	for (auto& plane : planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+size_t Frustum::cull(const CullBounds& bounds, std::vector<char>& visible) const {
+	visible.resize(bounds.x.size());
+	size_t visibleCount = 0;
+
+#ifdef FRUSTUM_SSE
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	for (size_t i = 0; i < bounds.x.size(); i += 4) {
+		__m128 x = _mm_loadu_ps(&bounds.x[i]);
+		__m128 y = _mm_loadu_ps(&bounds.y[i]);
+		__m128 z = _mm_loadu_ps(&bounds.z[i]);
+		__m128 negRadius = _mm_xor_ps(_mm_loadu_ps(&bounds.radius[i]), signMask);
+		__m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+		__m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+		__m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+
+		// a lane stays set while its sphere and box reach inside every plane
+		__m128 inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+		for (const auto& plane : planes) {
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+			__m128 reach = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::fabs(plane.x))), _mm_mul_ps(ey, _mm_set1_ps(std::fabs(plane.y)))),
+				_mm_mul_ps(ez, _mm_set1_ps(std::fabs(plane.z))));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_xor_ps(reach, signMask)));
+			if (_mm_movemask_ps(inside) == 0) {
+				break;
+			}
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; ++lane) {
+			visible[i + lane] = (mask >> lane) & 1;
+		}
+	}
+#else
+	for (size_t i = 0; i < bounds.x.size(); ++i) {
+		bool inside = true;
+		for (const auto& plane : planes) {
+			float distance = plane.x * bounds.x[i] + plane.y * bounds.y[i] + plane.z * bounds.z[i] + plane.w;
+			float reach = std::fabs(plane.x) * bounds.extentX[i] + std::fabs(plane.y) * bounds.extentY[i] + std::fabs(plane.z) * bounds.extentZ[i];
+			if (distance < -bounds.radius[i] || distance < -reach) {
+				inside = false;
+				break;
+			}
+		}
+		visible[i] = inside;
+	}
+#endif
+
+	// padding lanes are never drawn
+	for (size_t i = 0; i < bounds.count; ++i) {
+		visibleCount += visible[i];
+	}
+	return visibleCount;
+}
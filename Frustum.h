@@ -0,0 +1,40 @@
+#ifndef _FRUSTUM_H_
+#define _FRUSTUM_H_
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// World space bounds of many drawables as structure of arrays, so four of
+// them can be tested at once. Each has a bounding sphere and an axis aligned
+// box around the same center. Arrays are padded to a multiple of 4.
+struct CullBounds {
+	std::vector<float> x, y, z;
+	std::vector<float> radius;
+	// half size of the box on each axis
+	std::vector<float> extentX, extentY, extentZ;
+	// largest scale of the world matrix
+	std::vector<float> scale;
+	size_t count;
+
+	CullBounds() : count(0) {}
+	void resize(size_t size);
+	// bounds of a model space box and sphere around origin under the world matrix
+	void set(size_t i, const glm::mat4& world, const glm::vec3& boxMin, const glm::vec3& boxMax, float sphereRadius);
+};
+
+// Six planes of a view-projection matrix, pointing inwards.
+class Frustum
+{
+private:
+	glm::vec4 planes[6];
+
+public:
+	Frustum();
+	void extract(const glm::mat4& viewProjection);
+
+	// visible[i] is 1 when drawable i may be on screen, returns how many are.
+	// Spheres reject first, the box tightens what's left.
+	size_t cull(const CullBounds& bounds, std::vector<char>& visible) const;
+};
+
+#endif
@@ -2,7 +2,11 @@
 #define _GEOMETRY_H_
 
 #include "Node.h"
+#include "Mesh.h"
+#include "ShaderProgram.h"
+#include "RenderQueue.h"
 #include <list>
+#include <memory>
 #include <vector>
 #include <string>
 #include <fstream>
@@ -13,25 +17,48 @@ class Geometry : public Node
 {
 private:
 	glm::mat4 model;
-	GLuint shader;
-	std::vector<glm::vec3> points;
-	std::vector<glm::vec3> normals;
-	std::vector<glm::ivec3> faces;
+	ShaderProgram* shader;
+	// uniform locations, resolved once when the node is created
+	DrawUniforms uniforms;
 	glm::vec3 kAmbient;
 	glm::vec3 kDiffuse;
 	glm::vec3 kSpecular;
+	// drawn through InstancedRenderer instead of one draw call per object
+	bool instanced;
+	// box and sphere around the mesh after the model matrix, for culling
+	glm::vec3 boxMin, boxMax;
+	float sphereRadius;
+	glm::vec3 scale;
+	// largest scale of the model matrix, converts LOD errors
+	float modelScale;
+	// model matrix and bounds are set, once the mesh is resident
+	bool placed;
 
-	GLuint VAO, VBO, NBO, EBO;
+	// shared GPU buffers, owned by MeshCache
+	std::shared_ptr<Mesh> mesh;
 
 	std::list<Node*> children;
 
+	// center the mesh and compute the bounds, false while it is still loading
+	bool place();
+
 public:
-	Geometry(std::string objFilename, GLuint shader, glm::vec3 amb, glm::vec3 diff, glm::vec3 spec, glm::vec3 scale);
+	Geometry(std::string objFilename, ShaderProgram* shader, glm::vec3 amb, glm::vec3 diff, glm::vec3 spec, glm::vec3 scale, bool instanced = false);
 	~Geometry();
-	void draw(const glm::mat4& C);
-	void update();
+	void flatten(Scene& scene, int parent);
+	// queue a draw with C as the world matrix of the closest Transform above,
+	// at the level of detail for unitsPerPixel (in the space C maps from,
+	// 0 for full detail). Returns the triangles queued.
+	size_t render(const glm::mat4& C, float unitsPerPixel = 0.0f);
 	void addChild(Node* child);
 	void removeChild(Node* child);
+
+	// mesh resident and bounds set, never changes back
+	bool isPlaced() const { return placed; }
+	// culling bounds, empty until the mesh is resident
+	glm::vec3 getBoxMin() const { return boxMin; }
+	glm::vec3 getBoxMax() const { return boxMax; }
+	float getSphereRadius() const { return sphereRadius; }
 };
 
 #endif
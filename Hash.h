@@ -0,0 +1,19 @@
+#ifndef _HASH_H_
+#define _HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 64 bit FNV-1a. Not for hash tables or anything adversarial, only to tell
+// whether some bytes changed: mesh sources, shader sources, the end state
+// of a run.
+inline uint64_t hashBytes(const char* data, size_t size) {
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+#endif
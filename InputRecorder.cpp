@@ -0,0 +1,104 @@
+#include "InputRecorder.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+	const char recordingMagic[4] = { 'A', 'M', 'R', 'C' };
+	const uint32_t recordingVersion = 1;
+}
+
+RecordingHeader InputRecorder::header;
+std::vector<InputEvent> InputRecorder::events;
+std::string InputRecorder::filename;
+bool InputRecorder::recording = false;
+bool InputRecorder::replaying = false;
+size_t InputRecorder::cursor = 0;
+uint32_t InputRecorder::startTick = 0;
+
+bool InputRecorder::startRecording(const std::string& recordFilename, uint32_t seed, uint32_t agents, uint32_t particles, bool populated, uint32_t tick) {
+	// fail now rather than after a long session
+	std::ofstream out(recordFilename, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		std::cerr << "Can't write recording: " << recordFilename << std::endl;
+		return false;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, recordingMagic, sizeof(recordingMagic));
+	header.version = recordingVersion;
+	header.seed = seed;
+	header.agents = agents;
+	header.particles = particles;
+	header.populated = populated ? 1 : 0;
+	events.clear();
+	filename = recordFilename;
+	startTick = tick;
+	recording = true;
+	return true;
+}
+
+bool InputRecorder::stopRecording(uint32_t tick) {
+	if (!recording) {
+		return true;
+	}
+	recording = false;
+	header.ticks = tick - startTick;
+	header.eventCount = (uint32_t)events.size();
+
+	std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)events.data(), events.size() * sizeof(InputEvent));
+	if (!out.good()) {
+		std::cerr << "Can't write recording: " << filename << std::endl;
+		return false;
+	}
+	std::cerr << "Recorded " << header.ticks << " ticks and " << events.size() << " input events to " << filename << std::endl;
+	return true;
+}
+
+bool InputRecorder::startReplay(const std::string& replayFilename, uint32_t tick) {
+	std::ifstream in(replayFilename, std::ios::binary);
+	if (!in.is_open()) {
+		std::cerr << "Can't open recording: " << replayFilename << std::endl;
+		return false;
+	}
+
+	in.read((char*)&header, sizeof(header));
+	if (!in || memcmp(header.magic, recordingMagic, sizeof(recordingMagic)) != 0 || header.version != recordingVersion) {
+		std::cerr << "Not a recording: " << replayFilename << std::endl;
+		return false;
+	}
+	events.resize(header.eventCount);
+	in.read((char*)events.data(), events.size() * sizeof(InputEvent));
+	if (!in) {
+		std::cerr << "Truncated recording: " << replayFilename << std::endl;
+		return false;
+	}
+
+	filename = replayFilename;
+	cursor = 0;
+	startTick = tick;
+	replaying = true;
+	return true;
+}
+
+void InputRecorder::recordKeys(uint32_t tick, uint8_t keys) {
+	if (recording) {
+		events.push_back(InputEvent{ tick - startTick, InputEvent::Keys, keys, 0, 0, 0.0f });
+	}
+}
+
+void InputRecorder::recordCamera(uint32_t tick, float degrees, int8_t axis) {
+	if (recording) {
+		events.push_back(InputEvent{ tick - startTick, InputEvent::Camera, 0, axis, 0, degrees });
+	}
+}
+
+const InputEvent* InputRecorder::nextEvent(uint32_t tick) {
+	if (!replaying || cursor >= events.size() || events[cursor].tick > tick - startTick) {
+		return nullptr;
+	}
+	return &events[cursor++];
+}
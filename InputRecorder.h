@@ -0,0 +1,77 @@
+#ifndef _INPUT_RECORDER_H_
+#define _INPUT_RECORDER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// what a session needs to start the same way again
+struct RecordingHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t seed;
+	uint32_t agents;
+	uint32_t particles;
+	// 1 when the lobby was filled with agents before the first tick (headless)
+	uint32_t populated;
+	// ticks the session lasted
+	uint32_t ticks;
+	uint32_t eventCount;
+};
+
+// one change of input, applied at the start of a tick
+struct InputEvent {
+	enum Type : uint8_t {
+		// keys holds the movement keys, bit 0-3 for W, A, S and D
+		Keys = 0,
+		// the camera orbits by degrees around the x axis times axis
+		Camera = 1
+	};
+
+	// ticks since the session started
+	uint32_t tick;
+	uint8_t type;
+	uint8_t keys;
+	int8_t axis;
+	uint8_t padding;
+	float degrees;
+};
+
+// Records the input that changes a session, movement keys and camera drags,
+// stamped with the simulation tick it takes effect on, and writes it as a
+// compact binary file (the header, then 12 bytes per event, native byte
+// order). Replaying feeds the same changes in at the same ticks, and with
+// the recorded seed every RNG draws the same numbers, so the session runs
+// again tick for tick, e.g. to time a heavy scene before and after a change.
+class InputRecorder
+{
+private:
+	static RecordingHeader header;
+	static std::vector<InputEvent> events;
+	static std::string filename;
+	static bool recording;
+	static bool replaying;
+	// first event not replayed yet
+	static size_t cursor;
+	static uint32_t startTick;
+
+public:
+	static bool startRecording(const std::string& filename, uint32_t seed, uint32_t agents, uint32_t particles, bool populated, uint32_t tick);
+	// write the file, the session ended at tick
+	static bool stopRecording(uint32_t tick);
+	static bool startReplay(const std::string& filename, uint32_t tick);
+	// the header of the file being replayed, to start the session the same way
+	static const RecordingHeader& replayHeader() { return header; }
+
+	static bool isRecording() { return recording; }
+	static bool isReplaying() { return replaying; }
+	// every recorded tick has been replayed
+	static bool replayFinished(uint32_t tick) { return replaying && tick - startTick >= header.ticks; }
+
+	static void recordKeys(uint32_t tick, uint8_t keys);
+	static void recordCamera(uint32_t tick, float degrees, int8_t axis);
+	// next event due at tick, null when there is none
+	static const InputEvent* nextEvent(uint32_t tick);
+};
+
+#endif
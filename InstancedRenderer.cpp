@@ -0,0 +1,109 @@
+#include "InstancedRenderer.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <cstddef>
+
+std::vector<InstancedRenderer::Batch> InstancedRenderer::batches;
+std::vector<InstanceData> InstancedRenderer::uploadData;
+GLuint InstancedRenderer::instanceBuffer = 0;
+GLsizeiptr InstancedRenderer::instanceCapacity = 0;
+
+void InstancedRenderer::add(const std::shared_ptr<Mesh>& mesh, int lod, ShaderProgram* shader, const DrawUniforms& uniforms, const glm::vec3& kAmbient,
+	const glm::vec3& kSpecular, const glm::mat4& transform, const glm::vec3& kDiffuse) {
+	if (!mesh->isValid()) {
+		return;
+	}
+
+	// only a handful of distinct meshes, a linear search is fine
+	Batch* batch = nullptr;
+	for (auto& candidate : batches) {
+		if (candidate.mesh == mesh && candidate.lod == lod && candidate.shader == shader &&
+			candidate.kAmbient == kAmbient && candidate.kSpecular == kSpecular) {
+			batch = &candidate;
+			break;
+		}
+	}
+	if (!batch) {
+		batches.push_back(Batch{ mesh, lod, shader, uniforms.ambient, uniforms.specular, kAmbient, kSpecular, {} });
+		batch = &batches.back();
+	}
+
+	batch->instances.push_back(InstanceData{ transform, kDiffuse, 0.0f });
+}
+
+void InstancedRenderer::flush() {
+	PROFILE_SCOPE("InstancedRenderer::flush");
+	// batches that got no instances this frame are dropped, releasing their mesh
+	for (size_t i = 0; i < batches.size();) {
+		if (batches[i].instances.empty()) {
+			batches.erase(batches.begin() + i);
+		}
+		else {
+			++i;
+		}
+	}
+	if (batches.empty()) {
+		return;
+	}
+
+	// pack every batch into one array so the whole frame is a single upload
+	uploadData.clear();
+	for (const auto& batch : batches) {
+		uploadData.insert(uploadData.end(), batch.instances.begin(), batch.instances.end());
+	}
+
+	if (!instanceBuffer) {
+		glGenBuffers(1, &instanceBuffer);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	GLsizeiptr uploadSize = sizeof(InstanceData) * uploadData.size();
+	if (uploadSize > instanceCapacity) {
+		instanceCapacity = uploadSize * 2;
+	}
+	// orphan last frame's storage instead of waiting for the GPU to finish with it
+	glBufferData(GL_ARRAY_BUFFER, instanceCapacity, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, uploadSize, uploadData.data());
+
+	// Get back correct culling
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+
+	size_t first = 0;
+	for (auto& batch : batches) {
+		batch.shader->use();
+		glUniform3fv(batch.ambientLocation, 1, glm::value_ptr(batch.kAmbient));
+		glUniform3fv(batch.specularLocation, 1, glm::value_ptr(batch.kSpecular));
+
+		// point the per instance attributes of the mesh VAO at this batch's range
+		glBindVertexArray(batch.mesh->getVAO());
+		const char* base = (const char*)(sizeof(InstanceData) * first);
+		for (int column = 0; column < 4; ++column) {
+			glEnableVertexAttribArray(2 + column);
+			glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+				base + offsetof(InstanceData, transform) + sizeof(glm::vec4) * column);
+			glVertexAttribDivisor(2 + column, 1);
+		}
+		glEnableVertexAttribArray(6);
+		glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), base + offsetof(InstanceData, diffuse));
+		glVertexAttribDivisor(6, 1);
+
+		glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)batch.mesh->getLod(batch.lod).indexCount, batch.mesh->getIndexType(),
+			batch.mesh->getLodOffset(batch.lod), (GLsizei)batch.instances.size());
+
+		first += batch.instances.size();
+		batch.instances.clear();
+	}
+
+	// Unbind the VAO, buffer and shader program
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glUseProgram(0);
+}
+
+void InstancedRenderer::cleanUp() {
+	batches.clear();
+	if (instanceBuffer) {
+		glDeleteBuffers(1, &instanceBuffer);
+		instanceBuffer = 0;
+		instanceCapacity = 0;
+	}
+}
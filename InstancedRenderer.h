@@ -0,0 +1,49 @@
+#ifndef _INSTANCED_RENDERER_H_
+#define _INSTANCED_RENDERER_H_
+
+#include "Mesh.h"
+#include "ShaderProgram.h"
+#include "RenderQueue.h"
+#include "Profiler.h"
+#include <memory>
+#include <vector>
+
+// per instance data, read by toon.vert at attribute locations 2-6
+struct InstanceData {
+	glm::mat4 transform;
+	glm::vec3 diffuse;
+	float padding;
+};
+
+// Collects every instanced Geometry drawn during a frame and draws all
+// instances of the same mesh and material with one glDrawElementsInstanced.
+class InstancedRenderer
+{
+private:
+	struct Batch {
+		std::shared_ptr<Mesh> mesh;
+		int lod;
+		ShaderProgram* shader;
+		// locations in shader, looked up once by the Geometry
+		GLint ambientLocation;
+		GLint specularLocation;
+		glm::vec3 kAmbient;
+		glm::vec3 kSpecular;
+		std::vector<InstanceData> instances;
+	};
+
+	static std::vector<Batch> batches;
+	static std::vector<InstanceData> uploadData;
+	static GLuint instanceBuffer;
+	static GLsizeiptr instanceCapacity;
+
+public:
+	static void add(const std::shared_ptr<Mesh>& mesh, int lod, ShaderProgram* shader, const DrawUniforms& uniforms, const glm::vec3& kAmbient,
+		const glm::vec3& kSpecular, const glm::mat4& transform, const glm::vec3& kDiffuse);
+	// upload all instances gathered this frame and issue one draw per batch
+	static void flush();
+	static void cleanUp();
+	static size_t getDrawCount() { return batches.size(); }
+};
+
+#endif
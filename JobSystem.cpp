@@ -0,0 +1,173 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <string>
+
+namespace {
+	// queue of the calling thread, workers get 1 and up, everyone else 0
+	thread_local unsigned threadIndex = 0;
+
+	// failed attempts to find work before a worker goes to sleep
+	const int spinRounds = 64;
+}
+
+std::vector<std::thread> JobSystem::workers;
+std::unique_ptr<JobSystem::Queue[]> JobSystem::queues;
+unsigned JobSystem::queueCount = 0;
+std::atomic<size_t> JobSystem::queued(0);
+std::atomic<unsigned> JobSystem::sleeping(0);
+std::atomic<bool> JobSystem::stopping(false);
+std::mutex JobSystem::sleepMutex;
+std::condition_variable JobSystem::wake;
+
+void JobSystem::start(unsigned workerCount) {
+	if (!workers.empty()) {
+		return;
+	}
+	queueCount = workerCount + 1;
+	queues.reset(new Queue[queueCount]);
+	queued = 0;
+	stopping = false;
+	for (unsigned i = 1; i <= workerCount; ++i) {
+		workers.emplace_back(work, i);
+	}
+}
+
+void JobSystem::stop() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+	queues.reset();
+	queueCount = 0;
+}
+
+void JobSystem::work(unsigned index) {
+	threadIndex = index;
+	Profiler::setThreadName("job worker " + std::to_string(index));
+	while (!stopping.load(std::memory_order_acquire)) {
+		bool found = false;
+		for (int round = 0; round < spinRounds && !found; ++round) {
+			found = runOne(index);
+			if (!found) {
+				std::this_thread::yield();
+			}
+		}
+		if (found) {
+			continue;
+		}
+
+		// nothing queued anywhere, sleep until push() or stop() wakes us
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		++sleeping;
+		wake.wait(lock, [] { return stopping.load() || queued.load() > 0; });
+		--sleeping;
+	}
+}
+
+void JobSystem::push(unsigned index, const Range& range) {
+	{
+		std::lock_guard<std::mutex> lock(queues[index].mutex);
+		queues[index].ranges.push_back(range);
+	}
+	++queued;
+	// a worker that saw nothing queued is either still checking, and will
+	// see this range, or waiting under the mutex and gets the notification
+	if (sleeping.load() > 0) {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		wake.notify_one();
+	}
+}
+
+bool JobSystem::pop(unsigned index, Range& range) {
+	Queue& queue = queues[index];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.ranges.empty()) {
+		return false;
+	}
+	range = queue.ranges.back();
+	queue.ranges.pop_back();
+	--queued;
+	return true;
+}
+
+bool JobSystem::steal(unsigned index, Range& range) {
+	// start at the next queue so thieves spread over the victims
+	for (unsigned offset = 1; offset < queueCount; ++offset) {
+		Queue& queue = queues[(index + offset) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.ranges.empty()) {
+			continue;
+		}
+		range = queue.ranges.front();
+		queue.ranges.pop_front();
+		--queued;
+		return true;
+	}
+	return false;
+}
+
+bool JobSystem::runOne(unsigned index) {
+	if (queued.load(std::memory_order_relaxed) == 0) {
+		return false;
+	}
+	Range range;
+	if (!pop(index, range) && !steal(index, range)) {
+		return false;
+	}
+	execute(index, range);
+	return true;
+}
+
+void JobSystem::execute(unsigned index, Range range) {
+	// split at a chunk boundary until one chunk is left, queueing the second half
+	for (;;) {
+		size_t chunks = (range.end - range.begin + range.grain - 1) / range.grain;
+		if (chunks <= 1) {
+			break;
+		}
+		Range second = range;
+		second.begin = range.begin + chunks / 2 * range.grain;
+		range.end = second.begin;
+		push(index, second);
+	}
+
+	(*range.body)(range.begin, range.end);
+	// the loop may return as soon as this reaches 0, range is gone after it
+	range.remaining->fetch_sub(range.end - range.begin, std::memory_order_acq_rel);
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+	if (count == 0) {
+		return;
+	}
+	if (grain == 0) {
+		grain = 1;
+	}
+
+	// no one to share with, the same chunks in order
+	if (workers.empty() || count <= grain) {
+		for (size_t begin = 0; begin < count; begin += grain) {
+			body(begin, begin + grain < count ? begin + grain : count);
+		}
+		return;
+	}
+
+	std::atomic<size_t> remaining(count);
+	unsigned index = threadIndex;
+	execute(index, Range{ &body, 0, count, grain, &remaining });
+
+	// help with this loop, or whatever else is queued, until every chunk is done
+	while (remaining.load(std::memory_order_acquire) > 0) {
+		if (!runOne(index)) {
+			std::this_thread::yield();
+		}
+	}
+}
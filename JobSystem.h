@@ -0,0 +1,72 @@
+#ifndef _JOB_SYSTEM_H_
+#define _JOB_SYSTEM_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing pool for data parallel loops. Every thread has its own queue
+// of ranges: parallelFor splits its range in halves, keeps working on the
+// first half and queues the second, so the owner takes the small pieces from
+// the back while idle threads steal the large ones from the front. The
+// calling thread works on the loop too until all of it is done.
+// The split points only depend on the range and the grain, so body always
+// sees the chunks [k * grain, (k + 1) * grain), whatever the thread count;
+// as long as a chunk only writes its own items the result is the same with
+// one thread or many.
+class JobSystem
+{
+private:
+	struct Range {
+		const std::function<void(size_t, size_t)>* body;
+		size_t begin;
+		size_t end;
+		size_t grain;
+		// items of the loop not done yet, the loop is over at 0
+		std::atomic<size_t>* remaining;
+	};
+
+	// the owner pushes and pops at the back, thieves take from the front
+	struct alignas(64) Queue {
+		std::mutex mutex;
+		std::deque<Range> ranges;
+	};
+
+	static std::vector<std::thread> workers;
+	// queue 0 belongs to the thread calling from outside the pool
+	static std::unique_ptr<Queue[]> queues;
+	static unsigned queueCount;
+	static std::atomic<size_t> queued;
+	static std::atomic<unsigned> sleeping;
+	static std::atomic<bool> stopping;
+	static std::mutex sleepMutex;
+	static std::condition_variable wake;
+
+	static void work(unsigned index);
+	static void push(unsigned index, const Range& range);
+	static bool pop(unsigned index, Range& range);
+	static bool steal(unsigned index, Range& range);
+	// run one queued range, false when there was none anywhere
+	static bool runOne(unsigned index);
+	static void execute(unsigned index, Range range);
+
+public:
+	// start workerCount threads besides the caller, 0 runs every loop inline
+	static void start(unsigned workerCount);
+	// join the workers, no loop may be running
+	static void stop();
+	// threads working on a loop, the workers and the caller
+	static unsigned threadCount() { return (unsigned)workers.size() + 1; }
+
+	// call body(begin, end) on chunks of grain items covering [0, count) and
+	// return once all of them are done. Called by one thread outside the
+	// pool at a time, or from inside a body.
+	static void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+};
+
+#endif
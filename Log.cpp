@@ -0,0 +1,181 @@
+#include "Log.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace {
+	const size_t slotCount = 1024;
+	const size_t messageSize = 240;
+
+	struct Slot {
+		// slot index when free to write, index + 1 once the message is in
+		std::atomic<uint64_t> sequence;
+		LogLevel level;
+		char text[messageSize];
+	};
+
+	Slot slots[slotCount];
+	std::atomic<uint64_t> writePosition(0);
+	// only the writer thread touches this
+	uint64_t readPosition = 0;
+
+	std::atomic<bool> running(false);
+	std::thread writer;
+	std::ofstream file;
+	std::ostream* out = &std::cerr;
+
+	std::atomic<uint64_t> written(0);
+	std::atomic<uint64_t> dropped(0);
+	std::atomic<uint64_t> suppressedTotal(0);
+
+	const auto epoch = std::chrono::steady_clock::now();
+
+	uint64_t nowMs() {
+		return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	const char* prefix(LogLevel level) {
+		switch (level) {
+		case LogLevel::Debug: return "debug: ";
+		case LogLevel::Warning: return "warning: ";
+		case LogLevel::Error: return "error: ";
+		default: return "";
+		}
+	}
+}
+
+std::atomic<int> Log::level((int)LogLevel::Debug);
+uint32_t Log::burst = 10;
+
+bool Log::start(const std::string& filename) {
+	if (running) {
+		return true;
+	}
+	if (!filename.empty()) {
+		file.open(filename, std::ios::trunc);
+		if (!file.is_open()) {
+			std::cerr << "Can't open log file: " << filename << std::endl;
+			return false;
+		}
+		out = &file;
+	}
+
+	for (size_t i = 0; i < slotCount; ++i) {
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	writePosition.store(0, std::memory_order_relaxed);
+	readPosition = 0;
+	running.store(true, std::memory_order_release);
+	writer = std::thread([] {
+		while (running.load(std::memory_order_acquire)) {
+			drain();
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+		drain();
+	});
+	return true;
+}
+
+void Log::stop() {
+	if (!running) {
+		return;
+	}
+	running.store(false, std::memory_order_release);
+	writer.join();
+	out->flush();
+	if (file.is_open()) {
+		file.close();
+	}
+	out = &std::cerr;
+}
+
+void Log::drain() {
+	bool wrote = false;
+	for (;;) {
+		Slot& slot = slots[readPosition % slotCount];
+		if (slot.sequence.load(std::memory_order_acquire) != readPosition + 1) {
+			break;
+		}
+		*out << prefix(slot.level) << slot.text << '\n';
+		// hand the slot back to the producers for the next lap
+		slot.sequence.store(readPosition + slotCount, std::memory_order_release);
+		++readPosition;
+		wrote = true;
+	}
+	if (wrote) {
+		out->flush();
+	}
+}
+
+bool Log::allow(LogRateLimit& limit, uint32_t& suppressed) {
+	// approximate under contention, a few extra messages may slip through a window
+	uint64_t now = nowMs();
+	uint64_t windowStart = limit.windowStart.load(std::memory_order_relaxed);
+	if (now - windowStart >= 1000 && limit.windowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed)) {
+		limit.sent.store(0, std::memory_order_relaxed);
+	}
+	if (limit.sent.fetch_add(1, std::memory_order_relaxed) >= burst) {
+		limit.suppressed.fetch_add(1, std::memory_order_relaxed);
+		suppressedTotal.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	suppressed = limit.suppressed.exchange(0, std::memory_order_relaxed);
+	return true;
+}
+
+void Log::write(LogLevel messageLevel, LogRateLimit& limit, const char* format, ...) {
+	uint32_t suppressed = 0;
+	if (!allow(limit, suppressed)) {
+		return;
+	}
+
+	char text[messageSize];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	if (suppressed > 0 && length >= 0 && (size_t)length < sizeof(text)) {
+		snprintf(text + length, sizeof(text) - length, " (%u similar suppressed)", suppressed);
+	}
+
+	if (!running.load(std::memory_order_acquire)) {
+		std::cerr << prefix(messageLevel) << text << std::endl;
+		written.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	// claim the slot at the write position, or give up when it is still being read
+	uint64_t position = writePosition.load(std::memory_order_relaxed);
+	Slot* slot;
+	for (;;) {
+		slot = &slots[position % slotCount];
+		uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+		int64_t difference = (int64_t)(sequence - position);
+		if (difference == 0) {
+			if (writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (difference < 0) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		else {
+			position = writePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->level = messageLevel;
+	memcpy(slot->text, text, sizeof(text));
+	slot->sequence.store(position + 1, std::memory_order_release);
+	written.fetch_add(1, std::memory_order_relaxed);
+}
+
+LogStats Log::stats() {
+	return LogStats{ written.load(), dropped.load(), suppressedTotal.load() };
+}
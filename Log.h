@@ -0,0 +1,96 @@
+#ifndef _LOG_H_
+#define _LOG_H_
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+// messages below this level compile to nothing, 0 keeps debug messages
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 1
+#endif
+
+enum class LogLevel {
+	Debug = 0,
+	Info = 1,
+	Warning = 2,
+	Error = 3
+};
+
+// Per call site budget of messages, every LOG_ macro owns one. Lets through
+// Log::burst messages a second and counts the rest, the count is added to
+// the next message that gets through.
+struct LogRateLimit {
+	std::atomic<uint64_t> windowStart;
+	std::atomic<uint32_t> sent;
+	std::atomic<uint32_t> suppressed;
+};
+
+struct LogStats {
+	uint64_t written;
+	// lost because the ring was full
+	uint64_t dropped;
+	// held back by a rate limit
+	uint64_t suppressed;
+};
+
+// Formats messages on the calling thread into a fixed ring of slots and
+// writes them to stderr or a file from a background thread. Producers claim
+// a slot with one compare and swap (a bounded multi producer queue after
+// Vyukov) and never wait: a full ring drops the message and counts it.
+// Before start() and after stop() messages go straight to stderr.
+class Log
+{
+private:
+	static std::atomic<int> level;
+
+	static bool allow(LogRateLimit& limit, uint32_t& suppressed);
+	static void drain();
+
+public:
+	// messages a call site may write per second
+	static uint32_t burst;
+
+	// start the writer thread, filename empty for stderr
+	static bool start(const std::string& filename);
+	// write everything still queued and join the writer
+	static void stop();
+	// drop messages below level at run time too
+	static void setLevel(LogLevel minimum) { level.store((int)minimum, std::memory_order_relaxed); }
+	static bool isEnabled(LogLevel messageLevel) { return (int)messageLevel >= level.load(std::memory_order_relaxed); }
+
+	// printf style, longer messages are cut off
+	static void write(LogLevel messageLevel, LogRateLimit& limit, const char* format, ...)
+#if defined(__GNUC__)
+		__attribute__((format(printf, 3, 4)))
+#endif
+		;
+	static LogStats stats();
+};
+
+#define LOG_AT(messageLevel, ...) \
+	do { \
+		if (Log::isEnabled(messageLevel)) { \
+			static LogRateLimit logRateLimit; \
+			Log::write(messageLevel, logRateLimit, __VA_ARGS__); \
+		} \
+	} while (0)
+
+#if LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(...) LOG_AT(LogLevel::Debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+#if LOG_MIN_LEVEL <= 1
+#define LOG_INFO(...) LOG_AT(LogLevel::Info, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+#if LOG_MIN_LEVEL <= 2
+#define LOG_WARNING(...) LOG_AT(LogLevel::Warning, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+#define LOG_ERROR(...) LOG_AT(LogLevel::Error, __VA_ARGS__)
+
+#endif
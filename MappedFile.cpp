@@ -0,0 +1,112 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile() :
+	ptr(nullptr), length(0), opened(false),
+#ifdef _WIN32
+	fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL) {
+#else
+	fd(-1) {
+#endif
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const std::string& filename) {
+	close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize)) {
+		close();
+		return false;
+	}
+	length = (size_t)fileSize.QuadPart;
+
+	// an empty file can't be mapped, but it is still a valid (empty) file
+	if (length > 0) {
+		mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mappingHandle == NULL) {
+			close();
+			return false;
+		}
+		ptr = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (ptr == nullptr) {
+			close();
+			return false;
+		}
+	}
+#else
+	fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close();
+		return false;
+	}
+	length = (size_t)info.st_size;
+
+	// an empty file can't be mapped, but it is still a valid (empty) file
+	if (length > 0) {
+		void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped == MAP_FAILED) {
+			close();
+			return false;
+		}
+		ptr = (const char*)mapped;
+		// the whole file is read front to back, let the kernel read ahead
+		madvise(mapped, length, MADV_SEQUENTIAL);
+	}
+#endif
+
+	opened = true;
+	return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if (ptr) {
+		UnmapViewOfFile(ptr);
+	}
+	if (mappingHandle != NULL) {
+		CloseHandle(mappingHandle);
+		mappingHandle = NULL;
+	}
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		CloseHandle(fileHandle);
+		fileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (ptr) {
+		munmap((void*)ptr, length);
+	}
+	if (fd >= 0) {
+		::close(fd);
+		fd = -1;
+	}
+#endif
+	ptr = nullptr;
+	length = 0;
+	opened = false;
+}
@@ -0,0 +1,35 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <string>
+#include <stddef.h>
+
+// Read-only memory mapping of a whole file. The mapping lives until close()
+// or destruction, so pointers returned by data() must not outlive the object.
+class MappedFile
+{
+private:
+	const char* ptr;
+	size_t length;
+	bool opened;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fd;
+#endif
+
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& filename);
+	void close();
+	bool isOpen() const { return opened; }
+	const char* data() const { return ptr; }
+	size_t size() const { return length; }
+};
+
+#endif
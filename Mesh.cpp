@@ -0,0 +1,77 @@
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "Log.h"
+#include "Profiler.h"
+#include <cstddef>
+
+float Mesh::lodPixelError = 1.0f;
+
+Mesh::Mesh(const std::string& objFilename) :
+	filename(objFilename), VAO(0), VBO(0), EBO(0), indexCount(0), indexType(GL_UNSIGNED_INT), minBound(0), maxBound(0), maxRadius(0), dequantize(1), resident(false) {
+}
+
+void Mesh::upload(const MeshFile& mesh) {
+	PROFILE_SCOPE("Mesh::upload");
+	indexCount = (GLsizei)mesh.indexCount();
+	indexType = mesh.indexSize() == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	minBound = mesh.boundsMin();
+	maxBound = mesh.boundsMax();
+	maxRadius = mesh.radius();
+	dequantize = MeshBuilder::dequantize(minBound, mesh.quantizeScale());
+	lods.assign(mesh.lodArray(), mesh.lodArray() + mesh.lodCount());
+
+	// Generate a Vertex Array (VAO) and Vertex Buffer Object (VBO)
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+
+	// Bind VAO
+	glBindVertexArray(VAO);
+
+	// Bind VBO to the bound VAO, and store the interleaved vertices
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(PackedVertex) * mesh.vertexCount(), mesh.vertexArray(), GL_STATIC_DRAW);
+
+	// position at attribute 0 as unorm16, decoded by the model matrix
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+
+	// octahedral normal at attribute 1 as snorm16, decoded in the vertex shader
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+
+	// texture coordinate at attribute 7, after the per instance attributes of toon.vert
+	glEnableVertexAttribArray(7);
+	glVertexAttribPointer(7, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoord));
+
+	// Generate EBO, bind the EBO to the bound VAO, and send the index data
+	glGenBuffers(1, &EBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexSize() * mesh.indexCount(), mesh.indexArray(), GL_STATIC_DRAW);
+
+	// Unbind the VBO/VAO
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	resident.store(true, std::memory_order_release);
+	LOG_INFO("Finish loading %s", filename.c_str());
+}
+
+int Mesh::selectLod(float unitsPerPixel) const {
+	float allowed = unitsPerPixel * lodPixelError;
+	int lod = 0;
+	while (lod + 1 < (int)lods.size() && lods[lod + 1].error <= allowed) {
+		++lod;
+	}
+	return lod;
+}
+
+Mesh::~Mesh() {
+	// a mesh that never got uploaded may be released on a loader thread
+	if (!VAO) {
+		return;
+	}
+
+	// Delete the VBO and the VAO.
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	glDeleteVertexArrays(1, &VAO);
+}
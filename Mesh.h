@@ -0,0 +1,74 @@
+#ifndef _MESH_H_
+#define _MESH_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+
+#include "MeshBuilder.h"
+#include <glm/glm.hpp>
+#include <atomic>
+#include <string>
+#include <vector>
+
+class MeshFile;
+
+// GPU buffer set of one loaded model. Shared between every Geometry that
+// draws the same file, see MeshCache. Created empty, AssetLoader loads the
+// file and calls upload, until then the mesh is invalid.
+class Mesh
+{
+private:
+	std::string filename;
+	GLuint VAO, VBO, EBO;
+	GLsizei indexCount;
+	// GL_UNSIGNED_SHORT when every vertex fits, otherwise GL_UNSIGNED_INT
+	GLenum indexType;
+	glm::vec3 minBound;
+	glm::vec3 maxBound;
+	float maxRadius;
+	// packed to model space positions
+	glm::mat4 dequantize;
+	std::vector<MeshLod> lods;
+	// set once everything above is written, read by the simulation thread
+	std::atomic<bool> resident;
+
+public:
+	// largest error a level of detail may show on screen, in pixels
+	static float lodPixelError;
+
+	Mesh(const std::string& objFilename);
+	~Mesh();
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	// create the GL buffers from a loaded file, main thread only
+	void upload(const MeshFile& mesh);
+
+	const std::string& getFilename() const { return filename; }
+	// resident on the GPU and ready to draw, any thread
+	bool isValid() const { return resident.load(std::memory_order_acquire); }
+	GLuint getVAO() const { return VAO; }
+	// indices of every level together
+	GLsizei getIndexCount() const { return indexCount; }
+	size_t getLodCount() const { return lods.size(); }
+	const MeshLod& getLod(int lod) const { return lods[lod]; }
+	// what glDrawElements takes as the indices of a level
+	const void* getLodOffset(int lod) const {
+		return (const void*)((size_t)lods[lod].indexOffset * (indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint)));
+	}
+	// coarsest level whose error stays under lodPixelError when one pixel
+	// covers this many model units, 0 when nothing coarser is good enough
+	int selectLod(float unitsPerPixel) const;
+	GLenum getIndexType() const { return indexType; }
+	// vertex positions are quantized, put this to the right of the model matrix
+	const glm::mat4& getDequantize() const { return dequantize; }
+	glm::vec3 getCenter() const { return (minBound + maxBound) / 2.0f; }
+	glm::vec3 boundsMin() const { return minBound; }
+	glm::vec3 boundsMax() const { return maxBound; }
+	float radius() const { return maxRadius; }
+};
+
+#endif
@@ -0,0 +1,496 @@
+#include "MeshBuilder.h"
+#include "MeshSimplifier.h"
+#include "Log.h"
+
+#include <glm/gtx/transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+	struct CornerHash {
+		size_t operator()(const glm::ivec3& corner) const {
+			uint64_t hash = (uint64_t)(uint32_t)corner.x * 0x9E3779B97F4A7C15ull;
+			hash ^= (uint64_t)(uint32_t)corner.y * 0xC2B2AE3D27D4EB4Full + (hash >> 29);
+			hash ^= (uint64_t)(uint32_t)corner.z * 0x165667B19E3779F9ull + (hash >> 32);
+			return (size_t)hash;
+		}
+	};
+
+	int16_t toSnorm(float value) {
+		return (int16_t)std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f);
+	}
+
+	float signNotZero(float value) {
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	// Forsyth's scoring, see "Linear-Speed Vertex Cache Optimisation"
+	const int forsythCacheSize = 32;
+	const float cacheDecayPower = 1.5f;
+	const float lastTriangleScore = 0.75f;
+	const float valenceBoostScale = 2.0f;
+	const float valenceBoostPower = 0.5f;
+
+	float vertexScore(int cachePosition, unsigned remainingTriangles) {
+		if (remainingTriangles == 0) {
+			return -1.0f;
+		}
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			if (cachePosition < 3) {
+				// the triangle just drawn, don't favour it over its neighbours
+				score = lastTriangleScore;
+			}
+			else {
+				float scaler = 1.0f / (forsythCacheSize - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scaler, cacheDecayPower);
+			}
+		}
+		// finish off vertices with few triangles left so they leave the cache
+		return score + valenceBoostScale * std::pow((float)remainingTriangles, -valenceBoostPower);
+	}
+
+	// FIFO cache misses of each triangle, 0 to 3
+	std::vector<unsigned char> simulateMisses(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize) {
+		std::vector<unsigned char> misses(indices.size() / 3);
+		// a vertex is cached while fewer than cacheSize misses happened since it was loaded
+		std::vector<size_t> loadedAt(vertexCount, 0);
+		size_t missCount = cacheSize + 1;
+		for (size_t i = 0; i < indices.size(); ++i) {
+			uint32_t vertex = indices[i];
+			if (missCount - loadedAt[vertex] > cacheSize) {
+				loadedAt[vertex] = missCount++;
+				++misses[i / 3];
+			}
+		}
+		return misses;
+	}
+}
+
+glm::mat4 MeshBuilder::dequantize(const glm::vec3& boundsMin, float quantizeScale) {
+	// same scale on every axis, so normals still transform correctly
+	return glm::translate(boundsMin) * glm::scale(glm::vec3(quantizeScale));
+}
+
+void MeshBuilder::encodeNormal(const glm::vec3& normal, int16_t encoded[2]) {
+	// project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over
+	float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	if (length == 0.0f) {
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+	float x = normal.x / length;
+	float y = normal.y / length;
+	if (normal.z < 0.0f) {
+		float foldedX = (1.0f - std::fabs(y)) * signNotZero(x);
+		float foldedY = (1.0f - std::fabs(x)) * signNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+	encoded[0] = toSnorm(x);
+	encoded[1] = toSnorm(y);
+}
+
+glm::vec3 MeshBuilder::decodeNormal(const int16_t encoded[2]) {
+	// same as decodeNormal in the vertex shaders
+	glm::vec3 normal(std::max(encoded[0] / 32767.0f, -1.0f), std::max(encoded[1] / 32767.0f, -1.0f), 0.0f);
+	normal.z = 1.0f - std::fabs(normal.x) - std::fabs(normal.y);
+	float t = std::max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -t : t;
+	normal.y += normal.y >= 0.0f ? -t : t;
+	return glm::normalize(normal);
+}
+
+uint16_t MeshBuilder::toHalf(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (exponent >= 31) {
+		// too large, infinity and NaN all become infinity
+		return sign | 0x7c00;
+	}
+	if (exponent <= 0) {
+		// subnormal half or zero
+		if (exponent < -10) {
+			return sign;
+		}
+		mantissa |= 0x800000;
+		return sign | (uint16_t)((mantissa + (1u << (13 - exponent))) >> (14 - exponent));
+	}
+	// round to nearest, a carry into the exponent is still correct
+	return sign | (uint16_t)(((exponent << 10) | (mantissa >> 13)) + ((mantissa >> 12) & 1));
+}
+
+VertexCacheStats MeshBuilder::analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount) {
+	VertexCacheStats stats = { 0.0f, 0.0f };
+	if (indices.empty() || vertexCount == 0) {
+		return stats;
+	}
+	size_t total = 0;
+	for (unsigned char misses : simulateMisses(indices, vertexCount, cacheSize)) {
+		total += misses;
+	}
+	stats.acmr = (float)total / (indices.size() / 3);
+	stats.atvr = (float)total / vertexCount;
+	return stats;
+}
+
+void MeshBuilder::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+	size_t triangleCount = indices.size() / 3;
+
+	// triangles around each vertex, packed into one array
+	std::vector<unsigned> remaining(vertexCount, 0);
+	for (uint32_t vertex : indices) {
+		++remaining[vertex];
+	}
+	std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t i = 0; i < vertexCount; ++i) {
+		adjacencyStart[i + 1] = adjacencyStart[i] + remaining[i];
+	}
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i) {
+			adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> score(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i) {
+		score[i] = vertexScore(-1, remaining[i]);
+	}
+	std::vector<char> emitted(triangleCount, 0);
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	std::vector<uint32_t> cache, nextCache;
+	size_t scanFrom = 0;
+	int best = triangleCount > 0 ? 0 : -1;
+
+	while (best >= 0) {
+		emitted[best] = 1;
+		nextCache.clear();
+		for (int k = 0; k < 3; ++k) {
+			uint32_t vertex = indices[best * 3 + k];
+			result.push_back(vertex);
+			nextCache.push_back(vertex);
+
+			// drop the triangle from the vertex's list of remaining ones
+			uint32_t* begin = &adjacency[adjacencyStart[vertex]];
+			uint32_t* end = begin + remaining[vertex];
+			*std::find(begin, end, (uint32_t)best) = end[-1];
+			--remaining[vertex];
+		}
+		for (uint32_t vertex : cache) {
+			if (vertex != nextCache[0] && vertex != nextCache[1] && vertex != nextCache[2]) {
+				nextCache.push_back(vertex);
+			}
+		}
+
+		// rescore everything that entered, moved in or fell out of the cache
+		for (size_t i = 0; i < nextCache.size(); ++i) {
+			uint32_t vertex = nextCache[i];
+			cachePosition[vertex] = i < (size_t)forsythCacheSize ? (int)i : -1;
+			score[vertex] = vertexScore(cachePosition[vertex], remaining[vertex]);
+		}
+		if (nextCache.size() > (size_t)forsythCacheSize) {
+			nextCache.resize(forsythCacheSize);
+		}
+		cache.swap(nextCache);
+
+		// the next triangle is the best one touching the cache
+		best = -1;
+		float bestScore = -1.0f;
+		for (uint32_t vertex : cache) {
+			for (size_t a = adjacencyStart[vertex]; a < adjacencyStart[vertex] + remaining[vertex]; ++a) {
+				uint32_t triangle = adjacency[a];
+				float value = score[indices[triangle * 3]] + score[indices[triangle * 3 + 1]] + score[indices[triangle * 3 + 2]];
+				if (value > bestScore) {
+					bestScore = value;
+					best = (int)triangle;
+				}
+			}
+		}
+
+		// nothing left around the cache, continue with the next unused triangle in file order
+		if (best < 0) {
+			while (scanFrom < triangleCount && emitted[scanFrom]) {
+				++scanFrom;
+			}
+			best = scanFrom < triangleCount ? (int)scanFrom : -1;
+		}
+	}
+	indices.swap(result);
+}
+
+size_t MeshBuilder::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions) {
+	// Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced
+	// Overdraw". Cut the cache ordered list into clusters where it costs little
+	// cache efficiency, then draw the clusters facing outwards first.
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return 0;
+	}
+	const float threshold = 1.05f;
+	std::vector<unsigned char> misses = simulateMisses(indices, positions.size(), cacheSize);
+
+	// hard boundaries wherever the cache starts over, then split those clusters
+	// further where their running ACMR is already close to the cluster's
+	std::vector<size_t> clusters;
+	std::vector<size_t> loadedAt(positions.size(), 0);
+	size_t missCount = 0;
+	for (size_t start = 0; start < triangleCount;) {
+		size_t end = start + 1;
+		while (end < triangleCount && misses[end] < 3) {
+			++end;
+		}
+		size_t clusterMisses = 0;
+		for (size_t t = start; t < end; ++t) {
+			clusterMisses += misses[t];
+		}
+		float clusterAcmr = (float)clusterMisses / (end - start);
+
+		// each piece may be drawn after anything else, so it starts with a cold cache
+		size_t runMisses = 0;
+		size_t runStart = start;
+		clusters.push_back(start);
+		missCount += cacheSize + 1;
+		for (size_t t = start; t < end; ++t) {
+			for (int k = 0; k < 3; ++k) {
+				uint32_t vertex = indices[t * 3 + k];
+				if (missCount - loadedAt[vertex] > cacheSize) {
+					loadedAt[vertex] = missCount++;
+					++runMisses;
+				}
+			}
+			if (t + 1 < end && (float)runMisses / (t + 1 - runStart) <= threshold * clusterAcmr) {
+				clusters.push_back(t + 1);
+				runStart = t + 1;
+				runMisses = 0;
+				missCount += cacheSize + 1;
+			}
+		}
+		start = end;
+	}
+
+	// area weighted centroid of the whole mesh and of each cluster
+	glm::vec3 meshCentroid(0);
+	float meshArea = 0;
+	std::vector<glm::vec3> clusterCentroid(clusters.size(), glm::vec3(0));
+	std::vector<glm::vec3> clusterNormal(clusters.size(), glm::vec3(0));
+	std::vector<float> clusterArea(clusters.size(), 0.0f);
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+		for (size_t t = clusters[c]; t < end; ++t) {
+			const glm::vec3& a = positions[indices[t * 3]];
+			const glm::vec3& b = positions[indices[t * 3 + 1]];
+			const glm::vec3& d = positions[indices[t * 3 + 2]];
+			glm::vec3 normal = glm::cross(b - a, d - a);
+			float area = glm::length(normal);
+			glm::vec3 center = (a + b + d) / 3.0f;
+			clusterCentroid[c] += center * area;
+			clusterNormal[c] += normal;
+			clusterArea[c] += area;
+		}
+		meshCentroid += clusterCentroid[c];
+		meshArea += clusterArea[c];
+	}
+	if (meshArea > 0) {
+		meshCentroid /= meshArea;
+	}
+
+	// clusters facing away from the middle are more likely to hide the others
+	std::vector<float> outwards(clusters.size());
+	std::vector<size_t> order(clusters.size());
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		glm::vec3 centroid = clusterArea[c] > 0 ? clusterCentroid[c] / clusterArea[c] : clusterCentroid[c];
+		outwards[c] = glm::dot(centroid - meshCentroid, clusterNormal[c]);
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return outwards[a] > outwards[b];
+	});
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (size_t c : order) {
+		size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+		result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + end * 3);
+	}
+	indices.swap(result);
+	return clusters.size();
+}
+
+void MeshBuilder::optimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<PackedVertex>& vertices) {
+	// number vertices in the order they are first drawn
+	std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+	std::vector<PackedVertex> reordered;
+	reordered.reserve(vertices.size());
+	for (auto& index : indices) {
+		if (remap[index] == UINT32_MAX) {
+			remap[index] = (uint32_t)reordered.size();
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(reordered);
+}
+
+void MeshBuilder::report(const std::string& objFilename, const MeshBuildStats& stats) {
+	std::string lods;
+	for (size_t i = 0; i < stats.lodTriangles.size(); ++i) {
+		lods += (i == 0 ? "" : "/") + std::to_string(stats.lodTriangles[i]);
+	}
+	LOG_INFO("Built %s: %zu corners welded into %zu vertices, ACMR %g -> %g, ATVR %g -> %g, %zu overdraw clusters, LOD triangles %s",
+		objFilename.c_str(), stats.corners, stats.vertices, stats.before.acmr, stats.after.acmr, stats.before.atvr, stats.after.atvr,
+		stats.overdrawClusters, lods.c_str());
+}
+
+bool MeshBuilder::build(const ObjData& obj, MeshData& mesh, MeshBuildStats* stats) {
+	if (obj.points.empty() || obj.corners.empty()) {
+		return false;
+	}
+
+	// record max and min on 3 dimensions
+	mesh.boundsMin = obj.points[0];
+	mesh.boundsMax = obj.points[0];
+	for (const auto& point : obj.points) {
+		mesh.boundsMin = glm::min(mesh.boundsMin, point);
+		mesh.boundsMax = glm::max(mesh.boundsMax, point);
+	}
+
+	// record the maximum distance from the center
+	glm::vec3 center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+	mesh.radius = 0;
+	for (const auto& point : obj.points) {
+		mesh.radius = glm::max(mesh.radius, glm::length(point - center));
+	}
+
+	glm::vec3 size = mesh.boundsMax - mesh.boundsMin;
+	mesh.quantizeScale = std::max(std::max(size.x, size.y), std::max(size.z, 1e-6f));
+
+	// a corner whose normal index is missing or out of range gets a smooth
+	// normal, the same test decides which faces are smoothed and which corners use them
+	auto hasNormal = [&](const glm::ivec3& corner) {
+		return corner.z >= 0 && corner.z < (int)obj.normals.size();
+	};
+
+	// area weighted normals per position, for corners the file gave none
+	std::vector<glm::vec3> smoothNormals;
+	for (size_t i = 0; i + 2 < obj.corners.size(); i += 3) {
+		if (hasNormal(obj.corners[i]) && hasNormal(obj.corners[i + 1]) && hasNormal(obj.corners[i + 2])) {
+			continue;
+		}
+		if (smoothNormals.empty()) {
+			smoothNormals.assign(obj.points.size(), glm::vec3(0));
+		}
+		int a = obj.corners[i].x, b = obj.corners[i + 1].x, c = obj.corners[i + 2].x;
+		if (a < 0 || b < 0 || c < 0 || a >= (int)obj.points.size() || b >= (int)obj.points.size() || c >= (int)obj.points.size()) {
+			continue;
+		}
+		glm::vec3 faceNormal = glm::cross(obj.points[b] - obj.points[a], obj.points[c] - obj.points[a]);
+		smoothNormals[a] += faceNormal;
+		smoothNormals[b] += faceNormal;
+		smoothNormals[c] += faceNormal;
+	}
+
+	// one vertex per distinct corner, in order of first use
+	std::unordered_map<glm::ivec3, uint32_t, CornerHash> welded;
+	welded.reserve(obj.corners.size() / 2);
+	std::vector<uint32_t> indices;
+	indices.reserve(obj.corners.size());
+	mesh.vertices.clear();
+	// unquantized positions and normals of the welded vertices, for the overdraw sort and LODs
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+
+	for (const auto& corner : obj.corners) {
+		if (corner.x < 0 || corner.x >= (int)obj.points.size()) {
+			LOG_WARNING("Face index out of range: %d", corner.x + 1);
+			return false;
+		}
+		glm::ivec3 key(corner.x,
+			corner.y < (int)obj.texCoords.size() ? corner.y : -1,
+			hasNormal(corner) ? corner.z : -1);
+		auto found = welded.find(key);
+		if (found != welded.end()) {
+			indices.push_back(found->second);
+			continue;
+		}
+
+		PackedVertex vertex;
+		glm::vec3 position = (obj.points[key.x] - mesh.boundsMin) / mesh.quantizeScale;
+		for (int k = 0; k < 3; ++k) {
+			vertex.position[k] = (uint16_t)std::lround(glm::clamp(position[k], 0.0f, 1.0f) * 65535.0f);
+		}
+		vertex.position[3] = 0;
+		glm::vec3 normal = key.z >= 0 ? obj.normals[key.z] : smoothNormals[key.x];
+		encodeNormal(normal, vertex.normal);
+		glm::vec2 texCoord = key.y >= 0 ? obj.texCoords[key.y] : glm::vec2(0);
+		vertex.texCoord[0] = toHalf(texCoord.x);
+		vertex.texCoord[1] = toHalf(texCoord.y);
+
+		uint32_t index = (uint32_t)mesh.vertices.size();
+		mesh.vertices.push_back(vertex);
+		positions.push_back(obj.points[key.x]);
+		normals.push_back(glm::length(normal) > 0 ? glm::normalize(normal) : glm::vec3(0, 0, 1));
+		welded.emplace(key, index);
+		indices.push_back(index);
+	}
+
+	// triangle order for the vertex cache, then for overdraw, then vertex order for fetching
+	VertexCacheStats before = analyzeVertexCache(indices, mesh.vertices.size());
+	optimizeVertexCache(indices, mesh.vertices.size());
+	size_t clusters = optimizeOverdraw(indices, positions);
+	size_t fullIndexCount = indices.size();
+
+	// halve the triangles until it stops working or looks too different, each
+	// level simplified from the one before and appended to the same index buffer
+	mesh.lods.assign(1, MeshLod{ 0, (uint32_t)indices.size(), 0.0f });
+	std::vector<uint32_t> level(indices);
+	float error = 0.0f;
+	while (mesh.lods.size() < maxLods && level.size() / 3 > minLodTriangles) {
+		std::vector<uint32_t> simpler;
+		float levelError;
+		MeshSimplifier::simplify(level, positions, normals, level.size() / 6 * 3, simpler, levelError);
+		error += levelError;
+		if (simpler.size() > level.size() * 85 / 100 || error > mesh.radius * maxLodError) {
+			break;
+		}
+		optimizeVertexCache(simpler, mesh.vertices.size());
+		mesh.lods.push_back(MeshLod{ (uint32_t)indices.size(), (uint32_t)simpler.size(), error });
+		indices.insert(indices.end(), simpler.begin(), simpler.end());
+		level.swap(simpler);
+	}
+
+	// the full detail level comes first, so its vertices are the front of the buffer
+	optimizeVertexFetch(indices, mesh.vertices);
+	if (stats) {
+		stats->corners = obj.corners.size();
+		stats->vertices = mesh.vertices.size();
+		stats->before = before;
+		stats->after = analyzeVertexCache(std::vector<uint32_t>(indices.begin(), indices.begin() + fullIndexCount), mesh.vertices.size());
+		stats->overdrawClusters = clusters;
+		stats->lodTriangles.clear();
+		for (const auto& lod : mesh.lods) {
+			stats->lodTriangles.push_back(lod.indexCount / 3);
+		}
+	}
+
+	mesh.indices16.clear();
+	mesh.indices32.clear();
+	if (mesh.vertices.size() <= 65536) {
+		mesh.indices16.assign(indices.begin(), indices.end());
+	}
+	else {
+		mesh.indices32 = std::move(indices);
+	}
+	return true;
+}
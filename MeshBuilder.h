@@ -0,0 +1,101 @@
+#ifndef _MESH_BUILDER_H_
+#define _MESH_BUILDER_H_
+
+#include "ObjLoader.h"
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Interleaved vertex as uploaded, 16 bytes instead of two separate vec3.
+struct PackedVertex {
+	// unorm16 inside the mesh's bounding cube, w unused, see MeshData::quantizeScale
+	uint16_t position[4];
+	// octahedral encoded unit normal, snorm16
+	int16_t normal[2];
+	// half floats
+	uint16_t texCoord[2];
+};
+
+// one level of detail, a range of the index buffer
+struct MeshLod {
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	// estimated distance in model units from the full detail surface: the
+	// root mean square plane distance of each level's worst collapse, summed
+	// over the levels, not a bound on the largest distance
+	float error;
+};
+
+// A mesh ready for the GPU: one welded vertex per distinct (position,
+// texture coordinate, normal) triple and 16 bit indices when they fit.
+struct MeshData {
+	std::vector<PackedVertex> vertices;
+	// only one of the two is filled
+	std::vector<uint16_t> indices16;
+	std::vector<uint32_t> indices32;
+	// full detail first, every level uses the same vertices
+	std::vector<MeshLod> lods;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	// largest distance of a point from the bounds center
+	float radius;
+	// a position decodes as boundsMin + position / 65535 * quantizeScale
+	float quantizeScale;
+
+	size_t indexCount() const { return indices16.empty() ? indices32.size() : indices16.size(); }
+	size_t indexSize() const { return indices16.empty() ? sizeof(uint32_t) : sizeof(uint16_t); }
+	const void* indexData() const { return indices16.empty() ? (const void*)indices32.data() : (const void*)indices16.data(); }
+};
+
+// post-transform cache efficiency of an index buffer, simulated as a FIFO
+struct VertexCacheStats {
+	// vertex shader runs per triangle, 0.5 at best and 3 at worst
+	float acmr;
+	// vertex shader runs per vertex, 1 at best
+	float atvr;
+};
+
+struct MeshBuildStats {
+	size_t corners;
+	size_t vertices;
+	// triangle order as in the file and after optimizing
+	VertexCacheStats before;
+	VertexCacheStats after;
+	size_t overdrawClusters;
+	std::vector<size_t> lodTriangles;
+};
+
+class MeshBuilder
+{
+private:
+	static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+	static size_t optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions);
+	static void optimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<PackedVertex>& vertices);
+
+public:
+	// FIFO size assumed when measuring, typical of current GPUs
+	static const unsigned cacheSize = 16;
+	// LOD chain limits: levels, smallest level worth halving, error as a fraction of the radius
+	static const size_t maxLods = 6;
+	static const size_t minLodTriangles = 64;
+	static constexpr float maxLodError = 0.2f;
+
+	// weld the corners of a parsed OBJ and pack them. Corners without a
+	// normal get the smoothed normal of the faces around their position.
+	// Triangles are then reordered for the vertex cache and for overdraw, a
+	// chain of simplified levels is added and vertices are reordered for
+	// fetch locality.
+	static bool build(const ObjData& obj, MeshData& mesh, MeshBuildStats* stats = nullptr);
+	static VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount);
+	// one line report, e.g. "Built models/a.obj: 9000 corners, 2000 vertices, ACMR 1.41 -> 0.71, ..."
+	static void report(const std::string& objFilename, const MeshBuildStats& stats);
+
+	// matrix from packed to model space positions
+	static glm::mat4 dequantize(const glm::vec3& boundsMin, float quantizeScale);
+	static void encodeNormal(const glm::vec3& normal, int16_t encoded[2]);
+	static glm::vec3 decodeNormal(const int16_t encoded[2]);
+	static uint16_t toHalf(float value);
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "MeshCache.h"
+#include "AssetLoader.h"
+
+std::unordered_map<std::string, std::shared_ptr<Mesh>> MeshCache::meshes;
+
+std::shared_ptr<Mesh> MeshCache::acquire(const std::string& objFilename) {
+	auto found = meshes.find(objFilename);
+	if (found != meshes.end()) {
+		return found->second;
+	}
+
+	// drawn once AssetLoader has made it resident
+	auto mesh = std::make_shared<Mesh>(objFilename);
+	AssetLoader::load(mesh);
+	meshes.emplace(objFilename, mesh);
+	return mesh;
+}
+
+void MeshCache::clear() {
+	meshes.clear();
+}
@@ -0,0 +1,30 @@
+#ifndef _MESH_CACHE_H_
+#define _MESH_CACHE_H_
+
+#include "Mesh.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Loads every model file once and hands out shared references to its GPU
+// buffers, so spawning another copy of a model costs no file I/O and no
+// buffer creation. The first acquire queues the file on AssetLoader and
+// returns a mesh that becomes valid later. Must only be used while the GL
+// context is alive.
+// Meshes stay loaded for the whole run, until clear() at shutdown: the lobby
+// reuses a handful of models as astros come and go, so freeing one when its
+// last astro leaves would only load it again on the next spawn.
+class MeshCache
+{
+private:
+	static std::unordered_map<std::string, std::shared_ptr<Mesh>> meshes;
+
+public:
+	// the mesh for this file, queueing the load on first use
+	static std::shared_ptr<Mesh> acquire(const std::string& objFilename);
+	// drop the cache's own references, called before the GL context goes away
+	static void clear();
+	static size_t size() { return meshes.size(); }
+};
+
+#endif
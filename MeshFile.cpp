@@ -0,0 +1,270 @@
+#include "MeshFile.h"
+#include "Hash.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+	const char meshMagic[4] = { 'A', 'M', 'S', 'H' };
+	const uint32_t meshVersion = 4;
+
+	uint64_t alignUp(uint64_t offset) {
+		return (offset + 15) & ~(uint64_t)15;
+	}
+
+	// count elements at offset lie inside a file of fileSize bytes, written so nothing overflows
+	bool fitsInside(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize) {
+		return offset % 16 == 0 && offset <= fileSize && count <= (fileSize - offset) / elementSize;
+	}
+
+	// largest of count indices of indexSize bytes, the array is 16 byte aligned
+	uint32_t largestIndex(const char* data, uint32_t count, uint32_t indexSize) {
+		uint32_t largest = 0;
+		if (indexSize == 2) {
+			const uint16_t* indices = (const uint16_t*)data;
+			for (uint32_t i = 0; i < count; ++i) {
+				largest = std::max(largest, (uint32_t)indices[i]);
+			}
+		}
+		else {
+			const uint32_t* indices = (const uint32_t*)data;
+			for (uint32_t i = 0; i < count; ++i) {
+				largest = std::max(largest, indices[i]);
+			}
+		}
+		return largest;
+	}
+
+	// size and modification time of the source, zero when it can't be read
+	void sourceStamp(const std::string& filename, uint64_t& size, int64_t& time) {
+		std::error_code error;
+		size = (uint64_t)std::filesystem::file_size(filename, error);
+		if (error) {
+			size = 0;
+		}
+		auto writeTime = std::filesystem::last_write_time(filename, error);
+		time = error ? 0 : (int64_t)writeTime.time_since_epoch().count();
+	}
+}
+
+MeshFile::MeshFile() :
+	vertexData(nullptr), indexData(nullptr), lodData(nullptr), lodLevels(0), vertices(0), indices(0), indexBytes(4),
+	minBound(0), maxBound(0), maxRadius(0), scale(1), fromCache(false) {
+}
+
+std::string MeshFile::cachePath(const std::string& objFilename) {
+	std::filesystem::path path(objFilename);
+	path.replace_extension(".mesh");
+	return path.string();
+}
+
+bool MeshFile::load(const std::string& objFilename) {
+	auto start = std::chrono::steady_clock::now();
+	std::string cacheFilename = cachePath(objFilename);
+
+	if (openCache(cacheFilename, objFilename)) {
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		LOG_INFO("Mapped %s in %g ms", cacheFilename.c_str(), ms);
+		return true;
+	}
+
+	// cache missing or stale, parse the text file
+	ObjData parsed;
+	ObjLoadStats stats;
+	if (!ObjLoader::load(objFilename, parsed, &stats)) {
+		return false;
+	}
+	ObjLoader::report(objFilename, stats, "Parsed");
+#ifdef OBJ_LOADER_COMPARE
+	ObjData legacyData;
+	ObjLoadStats legacyStats;
+	if (ObjLoader::loadLegacy(objFilename, legacyData, &legacyStats)) {
+		ObjLoader::report(objFilename, legacyStats, "Parsed (legacy)");
+	}
+#endif
+
+	// weld and reorder into what gets uploaded, the cache keeps the result
+	MeshBuildStats buildStats;
+	if (!MeshBuilder::build(parsed, built, &buildStats)) {
+		LOG_WARNING("No faces in %s", objFilename.c_str());
+		return false;
+	}
+	MeshBuilder::report(objFilename, buildStats);
+
+	vertexData = built.vertices.data();
+	indexData = built.indexData();
+	lodData = built.lods.data();
+	lodLevels = built.lods.size();
+	vertices = built.vertices.size();
+	indices = built.indexCount();
+	indexBytes = built.indexSize();
+	minBound = built.boundsMin;
+	maxBound = built.boundsMax;
+	maxRadius = built.radius;
+	scale = built.quantizeScale;
+	fromCache = false;
+
+	if (!writeCache(cacheFilename, objFilename)) {
+		LOG_WARNING("Can't write mesh cache: %s", cacheFilename.c_str());
+	}
+	return true;
+}
+
+bool MeshFile::openCache(const std::string& cacheFilename, const std::string& objFilename) {
+	if (!mapping.open(cacheFilename)) {
+		return false;
+	}
+
+	MeshFileHeader header;
+	if (mapping.size() < sizeof(header)) {
+		mapping.close();
+		return false;
+	}
+	memcpy(&header, mapping.data(), sizeof(header));
+	if (memcmp(header.magic, meshMagic, sizeof(meshMagic)) != 0 || header.version != meshVersion) {
+		mapping.close();
+		return false;
+	}
+
+	// every array has to lie inside the file
+	if ((header.indexSize != 2 && header.indexSize != 4) ||
+		!fitsInside(header.verticesOffset, header.vertexCount, sizeof(PackedVertex), mapping.size()) ||
+		!fitsInside(header.indicesOffset, header.indexCount, header.indexSize, mapping.size()) ||
+		!fitsInside(header.lodsOffset, header.lodCount, sizeof(MeshLod), mapping.size()) ||
+		header.vertexCount == 0 || header.lodCount == 0) {
+		mapping.close();
+		return false;
+	}
+
+	// and every LOD inside the index array, or a draw reads past the index buffer
+	for (uint32_t i = 0; i < header.lodCount; ++i) {
+		MeshLod lod;
+		memcpy(&lod, mapping.data() + header.lodsOffset + i * sizeof(MeshLod), sizeof(lod));
+		if (lod.indexCount == 0 || lod.indexCount % 3 != 0 ||
+			(uint64_t)lod.indexOffset + lod.indexCount > header.indexCount) {
+			LOG_WARNING("Bad LOD %u in mesh cache: %s", i, cacheFilename.c_str());
+			mapping.close();
+			return false;
+		}
+	}
+
+	// and every index on a vertex, glDrawElements trusts them
+	if (largestIndex(mapping.data() + header.indicesOffset, header.indexCount, header.indexSize) >= header.vertexCount) {
+		LOG_WARNING("Index out of range in mesh cache: %s", cacheFilename.c_str());
+		mapping.close();
+		return false;
+	}
+
+	// the size/time stamp matches on every normal run; when it doesn't (fresh
+	// checkout, touched file) fall back to hashing the source contents
+	uint64_t size;
+	int64_t time;
+	sourceStamp(objFilename, size, time);
+	if (size != header.sourceSize || time != header.sourceTime) {
+		MappedFile source;
+		if (size != header.sourceSize || !source.open(objFilename) ||
+			hashBytes(source.data(), source.size()) != header.sourceHash) {
+			mapping.close();
+			return false;
+		}
+
+		// contents still match, refresh the stamp so the next run skips the hash.
+		// Windows won't open a mapped file for writing, so unmap it meanwhile
+		size_t mappedSize = mapping.size();
+		mapping.close();
+		{
+			std::fstream out(cacheFilename, std::ios::binary | std::ios::in | std::ios::out);
+			if (out.is_open()) {
+				out.seekp(offsetof(MeshFileHeader, sourceTime));
+				out.write((const char*)&time, sizeof(time));
+			}
+			if (!out.is_open() || !out.good()) {
+				LOG_WARNING("Can't refresh the source stamp of %s", cacheFilename.c_str());
+			}
+		}
+		if (!mapping.open(cacheFilename) || mapping.size() != mappedSize) {
+			mapping.close();
+			return false;
+		}
+	}
+
+	vertexData = (const PackedVertex*)(mapping.data() + header.verticesOffset);
+	indexData = mapping.data() + header.indicesOffset;
+	lodData = (const MeshLod*)(mapping.data() + header.lodsOffset);
+	lodLevels = header.lodCount;
+	vertices = header.vertexCount;
+	indices = header.indexCount;
+	indexBytes = header.indexSize;
+	minBound = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	maxBound = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	maxRadius = header.radius;
+	scale = header.quantizeScale;
+	fromCache = true;
+	return true;
+}
+
+bool MeshFile::writeCache(const std::string& cacheFilename, const std::string& objFilename) const {
+	MeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, meshMagic, sizeof(meshMagic));
+	header.version = meshVersion;
+
+	sourceStamp(objFilename, header.sourceSize, header.sourceTime);
+	MappedFile source;
+	if (!source.open(objFilename)) {
+		return false;
+	}
+	header.sourceHash = hashBytes(source.data(), source.size());
+
+	header.vertexCount = (uint32_t)vertices;
+	header.indexCount = (uint32_t)indices;
+	header.indexSize = (uint32_t)indexBytes;
+	header.lodCount = (uint32_t)lodLevels;
+	for (int i = 0; i < 3; ++i) {
+		header.boundsMin[i] = minBound[i];
+		header.boundsMax[i] = maxBound[i];
+	}
+	header.radius = maxRadius;
+	header.quantizeScale = scale;
+	header.verticesOffset = alignUp(sizeof(header));
+	header.indicesOffset = alignUp(header.verticesOffset + vertices * sizeof(PackedVertex));
+	header.lodsOffset = alignUp(header.indicesOffset + indices * indexBytes);
+
+	// write to a temporary file and rename it, so a half written cache is never mapped
+	std::string tempFilename = cacheFilename + ".tmp";
+	{
+		std::ofstream out(tempFilename, std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) {
+			return false;
+		}
+		const char zeros[16] = { 0 };
+		auto writeAt = [&](uint64_t offset, const void* data, size_t size) {
+			uint64_t position = (uint64_t)out.tellp();
+			out.write(zeros, offset - position);
+			out.write((const char*)data, size);
+		};
+		out.write((const char*)&header, sizeof(header));
+		writeAt(header.verticesOffset, vertexData, vertices * sizeof(PackedVertex));
+		writeAt(header.indicesOffset, indexData, indices * indexBytes);
+		writeAt(header.lodsOffset, lodData, lodLevels * sizeof(MeshLod));
+		if (!out.good()) {
+			out.close();
+			std::remove(tempFilename.c_str());
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempFilename, cacheFilename, error);
+	if (error) {
+		std::remove(tempFilename.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,84 @@
+#ifndef _MESH_FILE_H_
+#define _MESH_FILE_H_
+
+#include "MappedFile.h"
+#include "MeshBuilder.h"
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <string>
+
+// Binary mesh cache written next to each .obj ("models/a.obj" -> "models/a.mesh").
+// Welded vertices and indices are stored exactly as Mesh uploads them, so a valid
+// cache is mapped and handed straight to glBufferData without any conversion.
+// Native byte order.
+struct MeshFileHeader {
+	char magic[4];
+	uint32_t version;
+	// identity of the source .obj: cheap stamp first, content hash as fallback
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	uint64_t sourceHash;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	// 2 or 4 bytes
+	uint32_t indexSize;
+	uint32_t lodCount;
+	float boundsMin[3];
+	float boundsMax[3];
+	float radius;
+	float quantizeScale;
+	// byte offsets from the start of the file, 16 byte aligned
+	uint64_t verticesOffset;
+	uint64_t indicesOffset;
+	uint64_t lodsOffset;
+};
+
+class MeshFile
+{
+private:
+	// exactly one of these backs the arrays below
+	MappedFile mapping;
+	MeshData built;
+
+	const PackedVertex* vertexData;
+	const void* indexData;
+	const MeshLod* lodData;
+	size_t lodLevels;
+	size_t vertices;
+	size_t indices;
+	size_t indexBytes;
+	glm::vec3 minBound;
+	glm::vec3 maxBound;
+	float maxRadius;
+	float scale;
+	bool fromCache;
+
+	bool openCache(const std::string& cacheFilename, const std::string& objFilename);
+	bool writeCache(const std::string& cacheFilename, const std::string& objFilename) const;
+
+public:
+	MeshFile();
+
+	// map the cache when it matches the .obj, otherwise parse the .obj and rewrite the cache
+	bool load(const std::string& objFilename);
+	static std::string cachePath(const std::string& objFilename);
+
+	const PackedVertex* vertexArray() const { return vertexData; }
+	const void* indexArray() const { return indexData; }
+	size_t vertexCount() const { return vertices; }
+	size_t indexCount() const { return indices; }
+	// 2 or 4
+	size_t indexSize() const { return indexBytes; }
+	// full detail first
+	const MeshLod* lodArray() const { return lodData; }
+	size_t lodCount() const { return lodLevels; }
+	glm::vec3 boundsMin() const { return minBound; }
+	glm::vec3 boundsMax() const { return maxBound; }
+	// largest distance of a point from the bounds center
+	float radius() const { return maxRadius; }
+	// see MeshData::quantizeScale
+	float quantizeScale() const { return scale; }
+	bool loadedFromCache() const { return fromCache; }
+};
+
+#endif
@@ -0,0 +1,286 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+	// symmetric 4x4 error matrix of a set of weighted planes, upper triangle
+	struct Quadric {
+		double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+		double weight;
+
+		void addPlane(const glm::dvec3& normal, double distance, double planeWeight) {
+			a00 += planeWeight * normal.x * normal.x;
+			a01 += planeWeight * normal.x * normal.y;
+			a02 += planeWeight * normal.x * normal.z;
+			a03 += planeWeight * normal.x * distance;
+			a11 += planeWeight * normal.y * normal.y;
+			a12 += planeWeight * normal.y * normal.z;
+			a13 += planeWeight * normal.y * distance;
+			a22 += planeWeight * normal.z * normal.z;
+			a23 += planeWeight * normal.z * distance;
+			a33 += planeWeight * distance * distance;
+			weight += planeWeight;
+		}
+
+		void add(const Quadric& other) {
+			a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+			a11 += other.a11; a12 += other.a12; a13 += other.a13;
+			a22 += other.a22; a23 += other.a23; a33 += other.a33;
+			weight += other.weight;
+		}
+
+		// weighted sum of squared distances to the planes
+		double evaluate(const glm::dvec3& p) const {
+			return a00 * p.x * p.x + 2 * a01 * p.x * p.y + 2 * a02 * p.x * p.z + 2 * a03 * p.x
+				+ a11 * p.y * p.y + 2 * a12 * p.y * p.z + 2 * a13 * p.y
+				+ a22 * p.z * p.z + 2 * a23 * p.z + a33;
+		}
+	};
+
+	struct Collapse {
+		uint32_t from, to;
+		// mean squared distance after the collapse
+		double cost;
+	};
+
+	struct PositionHash {
+		size_t operator()(const glm::vec3& p) const {
+			// adding zero turns -0 into 0, they compare equal so they must hash the same
+			float coordinates[3] = { p.x + 0.0f, p.y + 0.0f, p.z + 0.0f };
+			uint32_t bits[3];
+			memcpy(bits, coordinates, sizeof(bits));
+			return (size_t)((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u));
+		}
+	};
+
+	// border edges get a plane through them perpendicular to their triangle, this much heavier
+	const double borderWeight = 10.0;
+
+	// collapses that would turn a triangle more than this far are rejected, cosine
+	const double minTurnCosine = 0.2;
+}
+
+void MeshSimplifier::simplify(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals, size_t targetIndexCount, std::vector<uint32_t>& result, float& error) {
+	result = indices;
+	error = 0.0f;
+
+	// collapses work on positions, every welded vertex maps to its position id
+	std::vector<uint32_t> positionOf(positions.size());
+	std::vector<glm::dvec3> points;
+	{
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> ids;
+		for (size_t v = 0; v < positions.size(); ++v) {
+			auto inserted = ids.emplace(positions[v], (uint32_t)points.size());
+			if (inserted.second) {
+				points.push_back(glm::dvec3(positions[v]));
+			}
+			positionOf[v] = inserted.first->second;
+		}
+	}
+	size_t pointCount = points.size();
+
+	// vertices at each position, to pick where a vertex goes when its position collapses
+	std::vector<std::vector<uint32_t>> verticesAt(pointCount);
+	for (size_t v = 0; v < positions.size(); ++v) {
+		verticesAt[positionOf[v]].push_back((uint32_t)v);
+	}
+
+	// planes of the triangles around each position, area weighted
+	std::vector<Quadric> quadrics(pointCount, Quadric());
+	std::vector<std::pair<uint64_t, uint32_t>> edges;
+	auto edgeKey = [](uint32_t a, uint32_t b) {
+		return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+	};
+	for (size_t i = 0; i + 2 < result.size(); i += 3) {
+		uint32_t p[3] = { positionOf[result[i]], positionOf[result[i + 1]], positionOf[result[i + 2]] };
+		glm::dvec3 normal = glm::cross(points[p[1]] - points[p[0]], points[p[2]] - points[p[0]]);
+		double area = glm::length(normal);
+		if (area <= 0) {
+			continue;
+		}
+		normal /= area;
+		double distance = -glm::dot(normal, points[p[0]]);
+		for (int k = 0; k < 3; ++k) {
+			quadrics[p[k]].addPlane(normal, distance, area * 0.5);
+			edges.push_back(std::make_pair(edgeKey(p[k], p[(k + 1) % 3]), (uint32_t)(i / 3)));
+		}
+	}
+
+	// edges used by one triangle only are on the border, keep them from shrinking inwards
+	std::sort(edges.begin(), edges.end());
+	for (size_t i = 0; i < edges.size();) {
+		size_t j = i;
+		while (j < edges.size() && edges[j].first == edges[i].first) {
+			++j;
+		}
+		if (j - i == 1) {
+			uint32_t a = (uint32_t)(edges[i].first >> 32), b = (uint32_t)edges[i].first;
+			size_t t = edges[i].second * 3;
+			glm::dvec3 faceNormal = glm::cross(points[positionOf[result[t + 1]]] - points[positionOf[result[t]]],
+				points[positionOf[result[t + 2]]] - points[positionOf[result[t]]]);
+			glm::dvec3 edge = points[b] - points[a];
+			glm::dvec3 normal = glm::cross(edge, faceNormal);
+			double length = glm::length(normal);
+			if (length > 0) {
+				normal /= length;
+				double weight = glm::dot(edge, edge) * borderWeight;
+				double distance = -glm::dot(normal, points[a]);
+				quadrics[a].addPlane(normal, distance, weight);
+				quadrics[b].addPlane(normal, distance, weight);
+			}
+		}
+		i = j;
+	}
+
+	std::vector<uint32_t> collapseTo(pointCount);
+	std::vector<char> locked(pointCount);
+	std::vector<size_t> adjacencyStart(pointCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<Collapse> collapses;
+	double worstCost = 0;
+
+	// each pass collapses the cheapest edges whose neighbourhoods don't overlap
+	while (result.size() > targetIndexCount) {
+		size_t triangleCount = result.size() / 3;
+
+		// triangles around each position
+		std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+		for (uint32_t v : result) {
+			++adjacencyStart[positionOf[v] + 1];
+		}
+		for (size_t p = 0; p < pointCount; ++p) {
+			adjacencyStart[p + 1] += adjacencyStart[p];
+		}
+		adjacency.resize(result.size());
+		{
+			std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+			for (size_t i = 0; i < result.size(); ++i) {
+				adjacency[fill[positionOf[result[i]]]++] = (uint32_t)(i / 3);
+			}
+		}
+
+		// cost of each edge collapsed onto its cheaper end
+		edges.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int k = 0; k < 3; ++k) {
+				uint32_t a = positionOf[result[i + k]], b = positionOf[result[i + (k + 1) % 3]];
+				edges.push_back(std::make_pair(edgeKey(a, b), 0u));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+		collapses.clear();
+		for (const auto& edge : edges) {
+			uint32_t a = (uint32_t)(edge.first >> 32), b = (uint32_t)edge.first;
+			Quadric sum = quadrics[a];
+			sum.add(quadrics[b]);
+			double weight = std::max(sum.weight, 1e-12);
+			double toB = std::max(sum.evaluate(points[b]), 0.0) / weight;
+			double toA = std::max(sum.evaluate(points[a]), 0.0) / weight;
+			collapses.push_back(toB <= toA ? Collapse{ a, b, toB } : Collapse{ b, a, toA });
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) {
+			return x.cost < y.cost;
+		});
+
+		for (size_t p = 0; p < pointCount; ++p) {
+			collapseTo[p] = (uint32_t)p;
+		}
+		std::fill(locked.begin(), locked.end(), 0);
+
+		size_t removed = 0;
+		size_t needed = triangleCount - targetIndexCount / 3;
+		for (const auto& collapse : collapses) {
+			if (removed >= needed) {
+				break;
+			}
+			if (locked[collapse.from] || locked[collapse.to]) {
+				continue;
+			}
+
+			// moving the position must not flip or fold any triangle that stays
+			bool valid = true;
+			size_t lost = 0;
+			for (size_t a = adjacencyStart[collapse.from]; a < adjacencyStart[collapse.from + 1] && valid; ++a) {
+				size_t t = adjacency[a] * 3;
+				uint32_t p[3] = { positionOf[result[t]], positionOf[result[t + 1]], positionOf[result[t + 2]] };
+				if (p[0] == collapse.to || p[1] == collapse.to || p[2] == collapse.to) {
+					++lost;
+					continue;
+				}
+				glm::dvec3 before = glm::cross(points[p[1]] - points[p[0]], points[p[2]] - points[p[0]]);
+				for (auto& q : p) {
+					if (q == collapse.from) {
+						q = collapse.to;
+					}
+				}
+				glm::dvec3 after = glm::cross(points[p[1]] - points[p[0]], points[p[2]] - points[p[0]]);
+				double lengths = glm::length(before) * glm::length(after);
+				valid = lengths > 0 && glm::dot(before, after) >= minTurnCosine * lengths;
+			}
+			if (!valid) {
+				continue;
+			}
+
+			// neither end nor anything next to them moves again in this pass
+			for (uint32_t end : { collapse.from, collapse.to }) {
+				for (size_t a = adjacencyStart[end]; a < adjacencyStart[end + 1]; ++a) {
+					size_t t = adjacency[a] * 3;
+					for (int k = 0; k < 3; ++k) {
+						locked[positionOf[result[t + k]]] = 1;
+					}
+				}
+			}
+			collapseTo[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			worstCost = std::max(worstCost, collapse.cost);
+			removed += lost;
+		}
+		if (removed == 0) {
+			break;
+		}
+
+		// move every vertex of a collapsed position onto the target vertex with the closest normal
+		std::unordered_map<uint32_t, uint32_t> moved;
+		size_t kept = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			uint32_t triangle[3];
+			for (int k = 0; k < 3; ++k) {
+				uint32_t v = result[i + k];
+				uint32_t target = collapseTo[positionOf[v]];
+				if (target != positionOf[v]) {
+					auto found = moved.find(v);
+					if (found == moved.end()) {
+						uint32_t best = verticesAt[target][0];
+						float bestDot = -2.0f;
+						for (uint32_t candidate : verticesAt[target]) {
+							float d = glm::dot(normals[v], normals[candidate]);
+							if (d > bestDot) {
+								bestDot = d;
+								best = candidate;
+							}
+						}
+						found = moved.emplace(v, best).first;
+					}
+					v = found->second;
+				}
+				triangle[k] = v;
+			}
+			uint32_t p0 = positionOf[triangle[0]], p1 = positionOf[triangle[1]], p2 = positionOf[triangle[2]];
+			if (p0 == p1 || p1 == p2 || p0 == p2) {
+				continue;
+			}
+			result[kept++] = triangle[0];
+			result[kept++] = triangle[1];
+			result[kept++] = triangle[2];
+		}
+		result.resize(kept);
+	}
+
+	error = (float)std::sqrt(worstCost);
+}
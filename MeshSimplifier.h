@@ -0,0 +1,25 @@
+#ifndef _MESH_SIMPLIFIER_H_
+#define _MESH_SIMPLIFIER_H_
+
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+// Quadric error edge collapse (Garland and Heckbert) over an indexed triangle
+// list. Vertices only ever move onto another existing vertex, so every level
+// reuses the one vertex buffer and just gets its own indices. Vertices that
+// share a position but not a normal collapse together, each onto the vertex
+// of the target position with the closest normal, so seams don't open up.
+class MeshSimplifier
+{
+public:
+	// simplify towards targetIndexCount indices, result may stop short when
+	// no collapse is left that doesn't flip a triangle. error is the root
+	// of the worst collapse's cost, the weighted mean squared distance to the
+	// planes it replaced, so roughly how far in model units the surface moved
+	// on top of what it had moved before.
+	static void simplify(const std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+		const std::vector<glm::vec3>& normals, size_t targetIndexCount, std::vector<uint32_t>& result, float& error);
+};
+
+#endif
@@ -11,11 +11,15 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "Profiler.h"
+#include "Scene.h"
+
 class Node
 {
 public:
-	virtual void draw(const glm::mat4& C) = 0;
-	virtual void update() = 0;
+	virtual ~Node() {}
+	// append this subtree to the scene's flat arrays, parent is the index of the closest Transform above
+	virtual void flatten(Scene& scene, int parent) = 0;
 };
 
 #endif
@@ -0,0 +1,336 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+	// don't bother spinning up a thread for less than this many bytes
+	const size_t minChunkBytes = 256 * 1024;
+
+	// everything one worker parsed out of its slice of the file
+	struct ObjChunk {
+		std::vector<glm::vec3> points;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> texCoords;
+		std::vector<glm::ivec3> corners;
+		// corners that used negative, i.e. chunk relative, indices
+		std::vector<size_t> pointFixups;
+		std::vector<size_t> texCoordFixups;
+		std::vector<size_t> normalFixups;
+	};
+
+	inline const char* skipSpaces(const char* p, const char* end) {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+			++p;
+		}
+		return p;
+	}
+
+	inline const char* parseFloat(const char* p, const char* end, float& value) {
+		p = skipSpaces(p, end);
+		// from_chars doesn't accept an explicit plus sign
+		if (p < end && *p == '+') {
+			++p;
+		}
+		auto result = std::from_chars(p, end, value);
+		return result.ec == std::errc() ? result.ptr : nullptr;
+	}
+
+	inline const char* parseInt(const char* p, const char* end, int& value) {
+		auto result = std::from_chars(p, end, value);
+		return result.ec == std::errc() ? result.ptr : nullptr;
+	}
+
+	// parse one "v", "v/vt", "v//vn" or "v/vt/vn" token, missing indices are 0
+	inline const char* parseCorner(const char* p, const char* end, int& vertex, int& texture, int& normal) {
+		texture = 0;
+		normal = 0;
+		p = parseInt(p, end, vertex);
+		if (!p || p == end || *p != '/') {
+			return p;
+		}
+		++p;
+		if (p < end && *p != '/') {
+			p = parseInt(p, end, texture);
+			if (!p) {
+				return nullptr;
+			}
+		}
+		if (p < end && *p == '/') {
+			p = parseInt(p + 1, end, normal);
+		}
+		return p;
+	}
+
+	// resolve a 1-based OBJ index; negative indices count back from the current
+	// end of the list and are only known relative to this chunk. 0 is no index
+	// at all and comes out as -1, like one reaching back past the start of the
+	// file does once rebased, so MeshBuilder rejects the face as out of range.
+	inline int resolveIndex(int index, size_t localCount, std::vector<size_t>& fixups, size_t corner) {
+		if (index > 0) {
+			return index - 1;
+		}
+		if (index == 0) {
+			return -1;
+		}
+		fixups.push_back(corner);
+		return (int)localCount + index;
+	}
+
+	void parseFace(const char* p, const char* end, ObjChunk& chunk) {
+		// position, texture coordinate and normal index of the triangle being built
+		glm::ivec3 tokens[3];
+		int corners = 0;
+
+		while (true) {
+			p = skipSpaces(p, end);
+			if (p >= end) {
+				break;
+			}
+
+			int vertex, texture, normal;
+			p = parseCorner(p, end, vertex, texture, normal);
+			if (!p) {
+				break;
+			}
+
+			// triangulate polygons as a fan around the first corner
+			if (corners >= 3) {
+				tokens[1] = tokens[2];
+			}
+			tokens[corners < 3 ? corners : 2] = glm::ivec3(vertex, texture, normal);
+			++corners;
+
+			if (corners >= 3) {
+				for (int k = 0; k < 3; ++k) {
+					size_t corner = chunk.corners.size();
+					glm::ivec3 resolved;
+					resolved.x = resolveIndex(tokens[k].x, chunk.points.size(), chunk.pointFixups, corner);
+					resolved.y = tokens[k].y == 0 ? -1 :
+						resolveIndex(tokens[k].y, chunk.texCoords.size(), chunk.texCoordFixups, corner);
+					resolved.z = tokens[k].z == 0 ? -1 :
+						resolveIndex(tokens[k].z, chunk.normals.size(), chunk.normalFixups, corner);
+					chunk.corners.push_back(resolved);
+				}
+			}
+		}
+	}
+
+	void parseChunk(const char* begin, const char* end, ObjChunk& chunk) {
+		const char* line = begin;
+		while (line < end) {
+			const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+			if (!lineEnd) {
+				lineEnd = end;
+			}
+
+			const char* p = skipSpaces(line, lineEnd);
+			if (lineEnd - p > 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+				// line is vertex
+				glm::vec3 vertex;
+				const char* q = parseFloat(p + 2, lineEnd, vertex.x);
+				q = q ? parseFloat(q, lineEnd, vertex.y) : nullptr;
+				q = q ? parseFloat(q, lineEnd, vertex.z) : nullptr;
+				if (q) {
+					chunk.points.push_back(vertex);
+				}
+			}
+			else if (lineEnd - p > 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+				// line is vertex normal
+				glm::vec3 normal;
+				const char* q = parseFloat(p + 3, lineEnd, normal.x);
+				q = q ? parseFloat(q, lineEnd, normal.y) : nullptr;
+				q = q ? parseFloat(q, lineEnd, normal.z) : nullptr;
+				if (q) {
+					chunk.normals.push_back(normal);
+				}
+			}
+			else if (lineEnd - p > 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t')) {
+				// line is texture coordinate, a third component is ignored
+				glm::vec2 texCoord;
+				const char* q = parseFloat(p + 3, lineEnd, texCoord.x);
+				q = q ? parseFloat(q, lineEnd, texCoord.y) : nullptr;
+				if (q) {
+					chunk.texCoords.push_back(texCoord);
+				}
+			}
+			else if (lineEnd - p > 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+				// line is face
+				parseFace(p + 2, lineEnd, chunk);
+			}
+
+			line = lineEnd + 1;
+		}
+	}
+
+	double secondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+bool ObjLoader::load(const std::string& objFilename, ObjData& data, ObjLoadStats* stats) {
+	auto start = std::chrono::steady_clock::now();
+
+	MappedFile file;
+	if (!file.open(objFilename)) {
+		LOG_WARNING("Can't open the file: %s", objFilename.c_str());
+		return false;
+	}
+
+	const char* begin = file.data();
+	const char* end = begin + file.size();
+
+	// split into roughly equal chunks, each one starting right after a newline
+	unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = (unsigned)std::min<size_t>(threadCount, file.size() / minChunkBytes + 1);
+
+	std::vector<const char*> bounds(threadCount + 1);
+	bounds[0] = begin;
+	bounds[threadCount] = end;
+	for (unsigned i = 1; i < threadCount; ++i) {
+		const char* p = std::max(begin + file.size() * i / threadCount, bounds[i - 1]);
+		const char* newline = (const char*)memchr(p, '\n', end - p);
+		bounds[i] = newline ? newline + 1 : end;
+	}
+
+	// parse every chunk on its own thread, the calling thread takes the first one
+	std::vector<ObjChunk> chunks(threadCount);
+	std::vector<std::thread> workers;
+	for (unsigned i = 1; i < threadCount; ++i) {
+		workers.emplace_back(parseChunk, bounds[i], bounds[i + 1], std::ref(chunks[i]));
+	}
+	parseChunk(bounds[0], bounds[1], chunks[0]);
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	// merge chunks in file order, rebasing chunk relative indices
+	size_t pointCount = 0, normalCount = 0, texCoordCount = 0, cornerCount = 0;
+	for (const auto& chunk : chunks) {
+		pointCount += chunk.points.size();
+		normalCount += chunk.normals.size();
+		texCoordCount += chunk.texCoords.size();
+		cornerCount += chunk.corners.size();
+	}
+
+	data.points.clear();
+	data.normals.clear();
+	data.texCoords.clear();
+	data.corners.clear();
+	data.points.reserve(pointCount);
+	data.normals.reserve(normalCount);
+	data.texCoords.reserve(texCoordCount);
+	data.corners.reserve(cornerCount);
+
+	for (auto& chunk : chunks) {
+		int pointOffset = (int)data.points.size();
+		int texCoordOffset = (int)data.texCoords.size();
+		int normalOffset = (int)data.normals.size();
+		for (size_t corner : chunk.pointFixups) {
+			chunk.corners[corner].x += pointOffset;
+		}
+		for (size_t corner : chunk.texCoordFixups) {
+			chunk.corners[corner].y += texCoordOffset;
+		}
+		for (size_t corner : chunk.normalFixups) {
+			chunk.corners[corner].z += normalOffset;
+		}
+		data.points.insert(data.points.end(), chunk.points.begin(), chunk.points.end());
+		data.normals.insert(data.normals.end(), chunk.normals.begin(), chunk.normals.end());
+		data.texCoords.insert(data.texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+		data.corners.insert(data.corners.end(), chunk.corners.begin(), chunk.corners.end());
+	}
+
+	if (stats) {
+		stats->bytes = file.size();
+		stats->threads = threadCount;
+		stats->seconds = secondsSince(start);
+	}
+	return true;
+}
+
+bool ObjLoader::loadLegacy(const std::string& objFilename, ObjData& data, ObjLoadStats* stats) {
+	auto start = std::chrono::steady_clock::now();
+
+	// parsing vertex, vertex normal and faces
+	std::ifstream objFile(objFilename);
+	if (!objFile.is_open()) {
+		LOG_WARNING("Can't open the file: %s", objFilename.c_str());
+		return false;
+	}
+
+	data.points.clear();
+	data.normals.clear();
+	data.texCoords.clear();
+	data.corners.clear();
+
+	std::string line;
+	size_t bytes = 0;
+	while (std::getline(objFile, line)) {
+		bytes += line.size() + 1;
+		std::stringstream ss;
+		ss << line;
+
+		// get the label
+		std::string label;
+		ss >> label;
+
+		// line is vertex
+		if (label == "v") {
+			// write position to a vec3 and add to points vector
+			glm::vec3 vertex;
+			ss >> vertex.x >> vertex.y >> vertex.z;
+			data.points.push_back(vertex);
+		}
+		// line is vertex normal
+		else if (label == "vn") {
+			// write normal data to a vec3 and push to temp normal vector
+			glm::vec3 normal;
+			ss >> normal.x >> normal.y >> normal.z;
+			data.normals.push_back(normal);
+		}
+		// line is texture coordinate
+		else if (label == "vt") {
+			glm::vec2 texCoord;
+			ss >> texCoord.x >> texCoord.y;
+			data.texCoords.push_back(texCoord);
+		}
+		// lien is face
+		else if (label == "f") {
+			// triangles only, each corner written as v//vn or v/vt/vn
+			std::string index;
+			for (int k = 0; k < 3; ++k) {
+				ss >> index;
+				size_t first = index.find('/');
+				size_t second = index.find('/', first + 1);
+				glm::ivec3 corner;
+				corner.x = std::stoi(index.substr(0, first)) - 1;
+				corner.y = second == first + 1 ? -1 : std::stoi(index.substr(first + 1, second - first - 1)) - 1;
+				corner.z = std::stoi(index.substr(second + 1)) - 1;
+				data.corners.push_back(corner);
+			}
+		}
+	}
+	objFile.close();
+
+	if (stats) {
+		stats->bytes = bytes;
+		stats->threads = 1;
+		stats->seconds = secondsSince(start);
+	}
+	return true;
+}
+
+void ObjLoader::report(const std::string& objFilename, const ObjLoadStats& stats, const char* label) {
+	double megabytes = stats.bytes / (1024.0 * 1024.0);
+	double seconds = std::max(stats.seconds, 1e-9);
+	LOG_INFO("%s %s: %g MB in %g ms (%g MB/s, %u %s)", label, objFilename.c_str(), megabytes, seconds * 1000.0,
+		megabytes / seconds, stats.threads, stats.threads == 1 ? "thread" : "threads");
+}
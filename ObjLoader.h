@@ -0,0 +1,42 @@
+#ifndef _OBJ_LOADER_H_
+#define _OBJ_LOADER_H_
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+
+// Uncomment to also time the old getline/stringstream parser on every load
+// and print both throughputs side by side.
+// #define OBJ_LOADER_COMPARE
+
+// parsed OBJ data with polygons split into triangles. Corners index the
+// three lists separately, as written in the file; MeshBuilder welds them
+// into the vertices that get uploaded.
+struct ObjData {
+	std::vector<glm::vec3> points;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texCoords;
+	// position, texture coordinate and normal index of each corner, 3 per
+	// triangle, -1 where the face didn't give one
+	std::vector<glm::ivec3> corners;
+};
+
+// throughput numbers of a single load
+struct ObjLoadStats {
+	size_t bytes;
+	unsigned threads;
+	double seconds;
+};
+
+class ObjLoader
+{
+public:
+	// memory-map the file, parse newline-aligned chunks in parallel and merge them
+	static bool load(const std::string& objFilename, ObjData& data, ObjLoadStats* stats = nullptr);
+	// original line-by-line parser, kept as a reference for timing comparisons
+	static bool loadLegacy(const std::string& objFilename, ObjData& data, ObjLoadStats* stats = nullptr);
+	// one line timing report, e.g. "models/a.obj: 12.1 MB in 30.2 ms (400.6 MB/s, 8 threads)"
+	static void report(const std::string& objFilename, const ObjLoadStats& stats, const char* label);
+};
+
+#endif
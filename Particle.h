@@ -2,6 +2,7 @@
 #define _PARTICLE_H_
 
 #include "Node.h"
+#include "ParticlePool.h"
 #include <list>
 #include <vector>
 #include <string>
@@ -9,25 +10,34 @@
 #include <stdlib.h>
 #include <time.h>
 
+// Particle effect attached to the scene graph. The particles live in a
+// ParticlePool slot that is only held while the effect is visible: emit()
+// takes one, and it goes back once emission has stopped and the last
+// particle died. When the pool is full the effect is skipped.
 class Particle : public Node
 {
 private:
-	GLuint shader;
-	glm::vec3 color;
-	float pointSize;
-	glm::mat4 model;
-	std::vector<glm::vec3> points;
-	GLuint VAO, VBO;
-
-	int counter;
+	EmitterSettings settings;
+	int slot;
+	// ticks since the last emit
+	unsigned ticks;
 
 public:
-	Particle(GLuint shader, glm::vec3 color, int count, float pointSize);
+	Particle(const EmitterSettings& settings);
 	~Particle();
-	void draw(const glm::mat4& C);
-	void update();
-	void spin(float deg);
-	void resetCounter();
+	void flatten(Scene& scene, int parent);
+	// advance the effect clock by one tick, true once the effect is over and
+	// its slot can go back with release(); touches nothing shared but its slot
+	bool update();
+	// give the slot back to the pool
+	void release();
+	// restart the effect with new settings
+	void emit(const EmitterSettings& settings);
+	// seconds since the last emit
+	float age() const { return ticks * ParticlePool::tickSeconds; }
+	bool isActive() const { return slot != -1; }
+	// pool slot the effect plays in, -1 when it doesn't
+	int getSlot() const { return slot; }
 };
 
 #endif
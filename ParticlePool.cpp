@@ -0,0 +1,232 @@
+#include "ParticlePool.h"
+#include "Transform.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+std::vector<ParticleSlotState> ParticlePool::slots;
+std::vector<int> ParticlePool::freeSlots;
+int ParticlePool::particlesPerSlot = 0;
+ParticlePoolStats ParticlePool::counters = { 0, 0, 0, 0, 0 };
+
+ShaderProgram* ParticlePool::shader = nullptr;
+ShaderProgram* ParticlePool::updateShader = nullptr;
+GLint ParticlePool::deltaTimeLoc = -1;
+GLint ParticlePool::seedLoc = -1;
+GLint ParticlePool::particlesPerSlotLoc = -1;
+GLint ParticlePool::drawParticlesPerSlotLoc = -1;
+GLuint ParticlePool::VAO[2] = { 0, 0 };
+GLuint ParticlePool::VBO[2] = { 0, 0 };
+GLuint ParticlePool::emitterBuffer = 0;
+int ParticlePool::current = 0;
+unsigned ParticlePool::seed = 0;
+unsigned ParticlePool::simulatedTick = 0;
+std::vector<glm::mat4> ParticlePool::transforms;
+std::vector<unsigned> ParticlePool::restartsDrawn;
+
+std::vector<ParticlePool::EmitterData> ParticlePool::emitterData;
+std::vector<GLint> ParticlePool::drawFirsts;
+std::vector<GLsizei> ParticlePool::drawCounts;
+
+float ParticlePool::tickSeconds = 1.0f / 60.0f;
+
+bool ParticlePool::init(int slotCount, int count, ShaderProgram* drawShader, ShaderProgram* simulateShader) {
+	if (slotCount < 1 || slotCount > maxSlots || count < 1) {
+		std::cerr << "Invalid particle pool size: " << slotCount << " slots of " << count << std::endl;
+		return false;
+	}
+
+	slots.assign(slotCount, ParticleSlotState());
+	freeSlots.clear();
+	for (int i = slotCount - 1; i >= 0; --i) {
+		freeSlots.push_back(i);
+	}
+	particlesPerSlot = count;
+	counters = { (size_t)slotCount, 0, 0, 0, 0 };
+	simulatedTick = Transform::tick;
+	transforms.assign(slotCount, glm::mat4(1));
+	restartsDrawn.assign(slotCount, 0);
+
+	shader = drawShader;
+	updateShader = simulateShader;
+	if (!shader || !updateShader) {
+		return true;
+	}
+
+	deltaTimeLoc = updateShader->uniform("deltaTime");
+	seedLoc = updateShader->uniform("seed");
+	particlesPerSlotLoc = updateShader->uniform("particlesPerSlot");
+	drawParticlesPerSlotLoc = shader->uniform("particlesPerSlot");
+
+	// both programs read the per slot data from the same block
+	for (auto program : { shader, updateShader }) {
+		GLuint blockIndex = glGetUniformBlockIndex(program->getID(), "EmitterBlock");
+		if (blockIndex != GL_INVALID_INDEX) {
+			glUniformBlockBinding(program->getID(), blockIndex, bindingPoint);
+		}
+	}
+	glGenBuffers(1, &emitterBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, emitterBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(EmitterData) * maxSlots, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	emitterData.assign(maxSlots, EmitterData());
+
+	// Generate the ping-pong pair, slots fill their range when they restart
+	glGenVertexArrays(2, VAO);
+	glGenBuffers(2, VBO);
+	for (int i = 0; i < 2; ++i) {
+		glBindVertexArray(VAO[i]);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO[i]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(ParticleVertex) * slotCount * count, nullptr, GL_DYNAMIC_COPY);
+
+		// position, velocity and life at attribute 0, 1 and 2
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, velocity));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, life));
+	}
+
+	// Unbind the VBO/VAO
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	return true;
+}
+
+void ParticlePool::cleanUp() {
+	if (VAO[0]) {
+		glDeleteBuffers(2, VBO);
+		glDeleteVertexArrays(2, VAO);
+		glDeleteBuffers(1, &emitterBuffer);
+		VAO[0] = VAO[1] = 0;
+		VBO[0] = VBO[1] = 0;
+		emitterBuffer = 0;
+	}
+	shader = nullptr;
+	updateShader = nullptr;
+	slots.clear();
+	freeSlots.clear();
+	transforms.clear();
+	restartsDrawn.clear();
+}
+
+int ParticlePool::acquire(const EmitterSettings& settings) {
+	if (freeSlots.empty()) {
+		++counters.failed;
+		return -1;
+	}
+
+	int slot = freeSlots.back();
+	freeSlots.pop_back();
+	slots[slot].used = true;
+	slots[slot].emitting = true;
+	restart(slot, settings);
+
+	++counters.acquired;
+	++counters.inUse;
+	counters.highWater = std::max(counters.highWater, counters.inUse);
+	return slot;
+}
+
+void ParticlePool::release(int slot) {
+	if (slot < 0 || slot >= (int)slots.size() || !slots[slot].used) {
+		return;
+	}
+	slots[slot].used = false;
+	freeSlots.push_back(slot);
+	--counters.inUse;
+}
+
+void ParticlePool::restart(int slot, const EmitterSettings& settings) {
+	slots[slot].settings = settings;
+	++slots[slot].restarts;
+}
+
+void ParticlePool::setEmitting(int slot, bool emitting) {
+	slots[slot].emitting = emitting;
+}
+
+void ParticlePool::setTransform(int slot, const glm::mat4& transform) {
+	transforms[slot] = transform;
+}
+
+void ParticlePool::simulate(float deltaTime) {
+	PROFILE_SCOPE("ParticlePool::simulate");
+	updateShader->use();
+	glUniform1f(deltaTimeLoc, deltaTime);
+	glUniform1ui(seedLoc, seed++);
+	glUniform1i(particlesPerSlotLoc, particlesPerSlot);
+
+	// read the current buffer and capture the new state of every slot into the other one
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(VAO[current]);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, VBO[1 - current]);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, (GLsizei)(transforms.size() * particlesPerSlot));
+	glEndTransformFeedback();
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glDisable(GL_RASTERIZER_DISCARD);
+	current = 1 - current;
+}
+
+void ParticlePool::flush(const std::vector<ParticleSlotState>& state, unsigned tick) {
+	PROFILE_SCOPE("ParticlePool::flush");
+	if (!VAO[0]) {
+		return;
+	}
+
+	// gather the per slot block and the ranges to draw, a slot restarted
+	// more than once since the last frame only starts over once
+	bool restarting = false;
+	drawFirsts.clear();
+	drawCounts.clear();
+	for (size_t i = 0; i < state.size(); ++i) {
+		const ParticleSlotState& slot = state[i];
+		const EmitterSettings& settings = slot.settings;
+		bool restart = slot.used && slot.restarts != restartsDrawn[i];
+		restartsDrawn[i] = slot.restarts;
+		EmitterData& data = emitterData[i];
+		data.transform = transforms[i];
+		data.color = glm::vec4(settings.color, settings.pointSize);
+		data.spawn = glm::vec4(settings.radius, settings.height, settings.speedJitter, settings.swirl);
+		data.velocity = glm::vec4(settings.velocity, settings.gravity);
+		data.timing = glm::vec4(settings.lifetime, restart, slot.emitting, slot.used);
+		if (slot.used) {
+			restarting = restarting || restart;
+			drawFirsts.push_back((GLint)(i * particlesPerSlot));
+			drawCounts.push_back(particlesPerSlot);
+		}
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, emitterBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(EmitterData) * state.size(), emitterData.data());
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, emitterBuffer);
+
+	// catch up on the ticks simulated since the last frame in one step,
+	// after a long stall just take a bigger one
+	unsigned pendingTicks = tick - simulatedTick;
+	simulatedTick = tick;
+	if (pendingTicks > 0 || restarting) {
+		simulate(std::min(pendingTicks, 15u) * tickSeconds);
+	}
+
+	if (drawFirsts.empty()) {
+		return;
+	}
+
+	// Actiavte the shader program, point sizes come from the block
+	shader->use();
+	glUniform1i(drawParticlesPerSlotLoc, particlesPerSlot);
+	glEnable(GL_PROGRAM_POINT_SIZE);
+
+	// Draw the slots in use from the latest state
+	glBindVertexArray(VAO[current]);
+	glMultiDrawArrays(GL_POINTS, drawFirsts.data(), drawCounts.data(), (GLsizei)drawFirsts.size());
+
+	// Unbind the VAO and shader program
+	glBindVertexArray(0);
+	glDisable(GL_PROGRAM_POINT_SIZE);
+	glUseProgram(0);
+}
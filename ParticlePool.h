@@ -0,0 +1,134 @@
+#ifndef _PARTICLE_POOL_H_
+#define _PARTICLE_POOL_H_
+
+#include "ShaderProgram.h"
+#include "Profiler.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+// How an emitter spawns and moves its particles, times in seconds and
+// distances in the emitter's space.
+struct EmitterSettings {
+	glm::vec3 color;
+	float pointSize;
+	// particles are born on a disc of this radius, up to this height
+	float radius;
+	float height;
+	glm::vec3 velocity;
+	// fraction the initial speed varies by
+	float speedJitter;
+	// turn rate around the emitter's y axis, radians per second
+	float swirl;
+	float gravity;
+	float lifetime;
+	// how long dead particles are born again, negative for forever
+	float duration;
+};
+
+// what the simulation decided for one slot, copied into every render snapshot
+struct ParticleSlotState {
+	bool used;
+	bool emitting;
+	// bumped by every restart, the renderer starts the slot over when it changes
+	unsigned restarts;
+	EmitterSettings settings;
+};
+
+struct ParticlePoolStats {
+	size_t slots;
+	size_t inUse;
+	// most slots in use at once
+	size_t highWater;
+	size_t acquired;
+	// acquires that found the pool full
+	size_t failed;
+};
+
+// Fixed number of emitter slots sharing one pair of particle buffers that is
+// allocated once. Slot i owns particles [i * particlesPerSlot, (i + 1) *
+// particlesPerSlot). Every frame one transform feedback pass advances all
+// slots (particle_update.vert), then one multi-draw renders the slots in
+// use, with per slot settings and transforms in a uniform block. Acquiring
+// and releasing a slot is bookkeeping only, no GL objects are created.
+// The bookkeeping belongs to the simulation thread; the render thread
+// draws from the copy of it in a RenderSnapshot and owns the transforms
+// and everything GL. Without shaders (headless) only the bookkeeping runs.
+class ParticlePool
+{
+private:
+	// layout of both buffers and of the feedback varyings
+	struct ParticleVertex {
+		glm::vec3 position;
+		glm::vec3 velocity;
+		glm::vec2 life;
+	};
+
+	// std140 layout of one entry of EmitterBlock in the particle shaders
+	struct EmitterData {
+		glm::mat4 transform;
+		// rgb and point size
+		glm::vec4 color;
+		// radius, height, speed jitter, swirl
+		glm::vec4 spawn;
+		// initial velocity and gravity
+		glm::vec4 velocity;
+		// lifetime, restart, emitting, in use
+		glm::vec4 timing;
+	};
+
+	static std::vector<ParticleSlotState> slots;
+	// unused slot indices, taken from the back
+	static std::vector<int> freeSlots;
+	static int particlesPerSlot;
+	static ParticlePoolStats counters;
+
+	static ShaderProgram* shader;
+	static ShaderProgram* updateShader;
+	static GLint deltaTimeLoc, seedLoc, particlesPerSlotLoc, drawParticlesPerSlotLoc;
+	static GLuint VAO[2], VBO[2];
+	static GLuint emitterBuffer;
+	// buffer holding the latest state
+	static int current;
+	static unsigned seed;
+	// render side: simulation tick the buffers were last advanced to, the
+	// transform of every slot and the restart count it was last drawn with
+	static unsigned simulatedTick;
+	static std::vector<glm::mat4> transforms;
+	static std::vector<unsigned> restartsDrawn;
+
+	static std::vector<EmitterData> emitterData;
+	static std::vector<GLint> drawFirsts;
+	static std::vector<GLsizei> drawCounts;
+
+	static void simulate(float deltaTime);
+
+public:
+	// size of EmitterBlock, 128 entries of 128 bytes fill the 16 KB every GL 3.3 driver supports
+	static const int maxSlots = 128;
+	// uniform buffer binding of EmitterBlock, FrameData uses 0
+	static const GLuint bindingPoint = 1;
+	// length of one simulation tick in seconds
+	static float tickSeconds;
+
+	// shaders may be null to only track slots
+	static bool init(int slotCount, int particlesPerSlot, ShaderProgram* shader, ShaderProgram* updateShader);
+	static void cleanUp();
+
+	// -1 when every slot is taken
+	static int acquire(const EmitterSettings& settings);
+	static void release(int slot);
+	// start the slot over with new settings
+	static void restart(int slot, const EmitterSettings& settings);
+	static void setEmitting(int slot, bool emitting);
+	// every slot, for the snapshot
+	static const std::vector<ParticleSlotState>& state() { return slots; }
+
+	// render thread: emitter to world transform, recorded while the scene is drawn
+	static void setTransform(int slot, const glm::mat4& transform);
+	// render thread: advance every slot to tick and draw the slots in use, as
+	// state (a snapshot of the bookkeeping) has them
+	static void flush(const std::vector<ParticleSlotState>& state, unsigned tick);
+	static ParticlePoolStats stats() { return counters; }
+};
+
+#endif
@@ -0,0 +1,344 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+	struct ScopeStats {
+		uint64_t total;
+		uint64_t calls;
+	};
+
+	struct CounterStats {
+		double total;
+		uint64_t samples;
+	};
+
+	// events and totals of one thread, the lock is only contended while a report or trace is written
+	struct ThreadData {
+		std::string label;
+		std::mutex mutex;
+		std::vector<ProfileEvent> events;
+		std::unordered_map<const char*, ScopeStats> stats;
+		std::vector<CounterEvent> counterEvents;
+		std::unordered_map<const char*, CounterStats> counters;
+	};
+
+	const auto epoch = std::chrono::steady_clock::now();
+
+	// threads are never unregistered, their events are still needed for the trace
+	std::mutex threadsMutex;
+	std::vector<std::unique_ptr<ThreadData>> threads;
+
+	ThreadData& registerThread(const std::string& label) {
+		std::lock_guard<std::mutex> lock(threadsMutex);
+		threads.push_back(std::make_unique<ThreadData>());
+		threads.back()->label = label.empty() ? "thread " + std::to_string(threads.size() - 1) : label;
+		return *threads.back();
+	}
+
+	ThreadData& threadData() {
+		thread_local ThreadData* data = &registerThread("");
+		return *data;
+	}
+
+	// GPU passes get a track of their own
+	ThreadData& gpuTrack() {
+		static ThreadData* data = &registerThread("GPU");
+		return *data;
+	}
+
+	void add(ThreadData& data, const char* name, uint64_t start, uint64_t duration, bool keepEvent) {
+		std::lock_guard<std::mutex> lock(data.mutex);
+		ScopeStats& stats = data.stats[name];
+		stats.total += duration;
+		++stats.calls;
+		if (keepEvent) {
+			data.events.push_back(ProfileEvent{ name, start, duration });
+		}
+	}
+
+	void writeEscaped(std::ostream& out, const std::string& text) {
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				out << '\\';
+			}
+			out << c;
+		}
+	}
+}
+
+std::atomic<bool> Profiler::enabled(false);
+bool Profiler::reporting = false;
+std::atomic<bool> Profiler::capturing(false);
+unsigned Profiler::captureFramesLeft = 0;
+std::string Profiler::captureFilename;
+
+std::vector<Profiler::GpuTimer> Profiler::gpuTimers;
+int Profiler::activeGpuTimer = -1;
+unsigned Profiler::frameParity = 0;
+unsigned Profiler::framesSinceReport = 0;
+uint64_t Profiler::lastReport = 0;
+bool Profiler::gpuTiming = false;
+
+uint64_t Profiler::now() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::refreshEnabled() {
+	bool on = reporting || capturing;
+	// endFrame stops collecting while off, forget the queries still out so
+	// the first frame after switching back on doesn't read ones from long ago
+	if (!on) {
+		for (auto& timer : gpuTimers) {
+			timer.pending[0] = false;
+			timer.pending[1] = false;
+		}
+	}
+	enabled.store(on, std::memory_order_relaxed);
+}
+
+void Profiler::setReporting(bool on) {
+	// start from clean totals
+	{
+		std::lock_guard<std::mutex> lock(threadsMutex);
+		for (auto& data : threads) {
+			std::lock_guard<std::mutex> threadLock(data->mutex);
+			data->stats.clear();
+			data->counters.clear();
+		}
+	}
+	reporting = on;
+	framesSinceReport = 0;
+	lastReport = now();
+	refreshEnabled();
+}
+
+void Profiler::captureTrace(const std::string& filename, unsigned frames) {
+	if (frames == 0) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(threadsMutex);
+		for (auto& data : threads) {
+			std::lock_guard<std::mutex> threadLock(data->mutex);
+			data->events.clear();
+			data->counterEvents.clear();
+		}
+	}
+	captureFilename = filename;
+	captureFramesLeft = frames;
+	capturing = true;
+	refreshEnabled();
+	std::cerr << "Capturing " << frames << " frames to " << filename << std::endl;
+}
+
+void Profiler::setThreadName(const std::string& name) {
+	ThreadData& data = threadData();
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	data.label = name;
+}
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end) {
+	add(threadData(), name, start, end - start, capturing.load(std::memory_order_relaxed));
+}
+
+void Profiler::counter(const char* name, double value) {
+	if (!isEnabled()) {
+		return;
+	}
+	ThreadData& data = threadData();
+	std::lock_guard<std::mutex> lock(data.mutex);
+	CounterStats& stats = data.counters[name];
+	stats.total += value;
+	++stats.samples;
+	if (capturing.load(std::memory_order_relaxed)) {
+		data.counterEvents.push_back(CounterEvent{ name, now(), value });
+	}
+}
+
+void Profiler::beginGpu(const char* name) {
+	int index = -1;
+	for (size_t i = 0; i < gpuTimers.size(); ++i) {
+		if (gpuTimers[i].name == name) {
+			index = (int)i;
+			break;
+		}
+	}
+	if (index == -1) {
+		GpuTimer timer = { name, { 0, 0 }, { 0, 0 }, { false, false } };
+		glGenQueries(2, timer.queries);
+		gpuTimers.push_back(timer);
+		index = (int)gpuTimers.size() - 1;
+	}
+
+	// this frame's slot was read back (or given up on) at the end of the frame before last
+	GpuTimer& timer = gpuTimers[index];
+	timer.cpuStart[frameParity] = now();
+	timer.pending[frameParity] = true;
+	glBeginQuery(GL_TIME_ELAPSED, timer.queries[frameParity]);
+	activeGpuTimer = index;
+}
+
+void Profiler::endGpu() {
+	if (activeGpuTimer == -1) {
+		return;
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+	activeGpuTimer = -1;
+}
+
+void Profiler::collectGpuTimers() {
+	// read last frame's queries, a result that still isn't ready is dropped rather than waited for
+	unsigned slot = frameParity ^ 1;
+	for (auto& timer : gpuTimers) {
+		if (!timer.pending[slot]) {
+			continue;
+		}
+		timer.pending[slot] = false;
+
+		GLint available = 0;
+		glGetQueryObjectiv(timer.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			continue;
+		}
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(timer.queries[slot], GL_QUERY_RESULT, &elapsed);
+		add(gpuTrack(), timer.name, timer.cpuStart[slot], elapsed, capturing);
+	}
+}
+
+void Profiler::endFrame() {
+	if (!isEnabled()) {
+		return;
+	}
+
+	if (gpuTiming) {
+		collectGpuTimers();
+	}
+	frameParity ^= 1;
+	++framesSinceReport;
+
+	if (reporting && now() - lastReport >= 1000000000ull) {
+		report();
+	}
+
+	if (capturing && --captureFramesLeft == 0) {
+		capturing = false;
+		if (writeTrace(captureFilename)) {
+			std::cerr << "Wrote trace " << captureFilename << std::endl;
+		}
+		refreshEnabled();
+	}
+}
+
+void Profiler::report() {
+	// merge by name, the same literal can have a different address in each file
+	std::map<std::string, ScopeStats> merged;
+	std::map<std::string, CounterStats> counters;
+	{
+		std::lock_guard<std::mutex> lock(threadsMutex);
+		for (auto& data : threads) {
+			std::lock_guard<std::mutex> threadLock(data->mutex);
+			std::string prefix = data->label == "GPU" ? "gpu " : "";
+			for (auto& entry : data->stats) {
+				ScopeStats& stats = merged[prefix + entry.first];
+				stats.total += entry.second.total;
+				stats.calls += entry.second.calls;
+			}
+			data->stats.clear();
+			for (auto& entry : data->counters) {
+				CounterStats& stats = counters[entry.first];
+				stats.total += entry.second.total;
+				stats.samples += entry.second.samples;
+			}
+			data->counters.clear();
+		}
+	}
+
+	std::vector<std::pair<std::string, ScopeStats>> sorted(merged.begin(), merged.end());
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, ScopeStats>& a, const std::pair<std::string, ScopeStats>& b) {
+		return a.second.total > b.second.total;
+	});
+
+	uint64_t time = now();
+	double frames = framesSinceReport;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Profile: " << framesSinceReport << " frames, " << (time - lastReport) / 1e6 / frames << " ms/frame" << std::endl;
+	for (auto& entry : sorted) {
+		std::cout << "  " << std::left << std::setw(28) << entry.first << std::right
+			<< std::setw(10) << entry.second.total / 1e6 / frames << " ms/frame"
+			<< std::setw(10) << entry.second.calls / frames << " calls/frame" << std::endl;
+	}
+	for (auto& entry : counters) {
+		std::cout << "  " << std::left << std::setw(28) << entry.first << std::right
+			<< std::setw(10) << entry.second.total / entry.second.samples << " avg" << std::endl;
+	}
+	std::cout.unsetf(std::ios::floatfield);
+
+	framesSinceReport = 0;
+	lastReport = time;
+}
+
+bool Profiler::writeTrace(const std::string& filename) {
+	std::ofstream out(filename, std::ios::trunc);
+	if (!out.is_open()) {
+		std::cerr << "Can't write trace: " << filename << std::endl;
+		return false;
+	}
+
+	// Chrome trace event format, complete ("X") events with times in microseconds
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for (size_t tid = 0; tid < threads.size(); ++tid) {
+		ThreadData& data = *threads[tid];
+		std::lock_guard<std::mutex> threadLock(data.mutex);
+
+		out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+			<< ",\"args\":{\"name\":\"";
+		writeEscaped(out, data.label);
+		out << "\"}}";
+		first = false;
+
+		for (const auto& event : data.events) {
+			out << ",\n{\"name\":\"";
+			writeEscaped(out, event.name);
+			out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+				<< ",\"ts\":" << event.start / 1000 << "." << std::setw(3) << std::setfill('0') << event.start % 1000
+				<< ",\"dur\":" << event.duration / 1000 << "." << std::setw(3) << event.duration % 1000
+				<< std::setfill(' ') << "}";
+		}
+		data.events.clear();
+
+		// counter ("C") events, drawn as a graph
+		for (const auto& event : data.counterEvents) {
+			out << ",\n{\"name\":\"";
+			writeEscaped(out, event.name);
+			out << "\",\"ph\":\"C\",\"pid\":1,\"tid\":" << tid
+				<< ",\"ts\":" << event.time / 1000 << "." << std::setw(3) << std::setfill('0') << event.time % 1000
+				<< std::setfill(' ') << ",\"args\":{\"value\":" << event.value << "}}";
+		}
+		data.counterEvents.clear();
+	}
+	out << "\n]}\n";
+	return out.good();
+}
+
+void Profiler::cleanUp() {
+	if (gpuTiming) {
+		for (auto& timer : gpuTimers) {
+			glDeleteQueries(2, timer.queries);
+		}
+	}
+	gpuTimers.clear();
+	activeGpuTimer = -1;
+}
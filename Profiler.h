@@ -0,0 +1,132 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// one finished scope, times in nanoseconds since the profiler started
+struct ProfileEvent {
+	const char* name;
+	uint64_t start;
+	uint64_t duration;
+};
+
+// one sample of a named value, shown as a graph in the trace
+struct CounterEvent {
+	const char* name;
+	uint64_t time;
+	double value;
+};
+
+// Scoped CPU timers and double buffered GL_TIME_ELAPSED queries. While
+// disabled a scope costs one relaxed load and a branch, so the macros stay
+// compiled into release builds. Enabled, it prints per frame averages about
+// once a second, counters as their per frame average; a capture records
+// every event and counter sample for some frames and writes them as a Chrome
+// trace (load it in chrome://tracing or ui.perfetto.dev).
+// Scope names must be string literals, they are stored by pointer.
+class Profiler
+{
+private:
+	struct GpuTimer {
+		const char* name;
+		GLuint queries[2];
+		uint64_t cpuStart[2];
+		bool pending[2];
+	};
+
+	static std::atomic<bool> enabled;
+	static bool reporting;
+	static std::atomic<bool> capturing;
+	static unsigned captureFramesLeft;
+	static std::string captureFilename;
+
+	static std::vector<GpuTimer> gpuTimers;
+	static int activeGpuTimer;
+	static unsigned frameParity;
+	static unsigned framesSinceReport;
+	static uint64_t lastReport;
+
+	static void refreshEnabled();
+	static void collectGpuTimers();
+	static void report();
+
+public:
+	// GL queries are only issued when a context exists
+	static bool gpuTiming;
+
+	static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+	// print per frame averages once a second
+	static void setReporting(bool on);
+	static bool isReporting() { return reporting; }
+	// record everything for the next frames, then write filename
+	static void captureTrace(const std::string& filename, unsigned frames);
+	static bool isCapturing() { return capturing; }
+
+	// label of the calling thread in reports and traces
+	static void setThreadName(const std::string& name);
+	static uint64_t now();
+	static void record(const char* name, uint64_t start, uint64_t end);
+	// sample a value once per frame, e.g. how many objects were drawn
+	static void counter(const char* name, double value);
+	// time the GL commands between the two calls, passes can't nest
+	static void beginGpu(const char* name);
+	static void endGpu();
+	// call once per frame on the main thread
+	static void endFrame();
+	static bool writeTrace(const std::string& filename);
+	static void cleanUp();
+};
+
+class ProfileScope
+{
+private:
+	const char* name;
+	uint64_t start;
+	bool active;
+
+public:
+	ProfileScope(const char* name) : name(name), start(0), active(Profiler::isEnabled()) {
+		if (active) {
+			start = Profiler::now();
+		}
+	}
+	~ProfileScope() {
+		if (active) {
+			Profiler::record(name, start, Profiler::now());
+		}
+	}
+};
+
+class GpuProfileScope
+{
+private:
+	bool active;
+
+public:
+	GpuProfileScope(const char* name) : active(Profiler::isEnabled() && Profiler::gpuTiming) {
+		if (active) {
+			Profiler::beginGpu(name);
+		}
+	}
+	~GpuProfileScope() {
+		if (active) {
+			Profiler::endGpu();
+		}
+	}
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+
+#endif
@@ -0,0 +1,125 @@
+#include "ProgramCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+	const char programMagic[4] = { 'P', 'R', 'G', 'B' };
+	const uint32_t programVersion = 1;
+
+	const char* glString(GLenum name) {
+		const GLubyte* value = glGetString(name);
+		return value ? (const char*)value : "";
+	}
+}
+
+int ProgramCache::support = 0;
+std::string ProgramCache::driver;
+
+bool ProgramCache::isSupported() {
+	if (support == 0) {
+		// core in 4.1, which is what macOS gives us
+#ifdef __APPLE__
+		bool extension = true;
+#else
+		bool extension = GLEW_ARB_get_program_binary;
+#endif
+		GLint formats = 0;
+		if (extension) {
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		}
+		support = formats > 0 ? 1 : -1;
+		driver = std::string(glString(GL_VENDOR)) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION);
+	}
+	return support == 1;
+}
+
+std::string ProgramCache::cachePath(const std::string& vertexFilePath) {
+	std::filesystem::path path(vertexFilePath);
+	path.replace_extension(".program");
+	return path.string();
+}
+
+uint64_t ProgramCache::key(const std::string& sources) {
+	isSupported();
+	std::string keyed = driver + "\n" + sources;
+	return hashBytes(keyed.data(), keyed.size());
+}
+
+GLuint ProgramCache::load(const std::string& filename, uint64_t key) {
+	if (!isSupported()) {
+		return 0;
+	}
+
+	MappedFile file;
+	ProgramFileHeader header;
+	if (!file.open(filename) || file.size() < sizeof(header)) {
+		return 0;
+	}
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, programMagic, sizeof(programMagic)) != 0 || header.version != programVersion ||
+		header.key != key || sizeof(header) + (uint64_t)header.binarySize > file.size()) {
+		return 0;
+	}
+
+	// the driver may still refuse a binary it wrote, e.g. after a silent update
+	GLuint programID = glCreateProgram();
+	glProgramBinary(programID, header.binaryFormat, file.data() + sizeof(header), (GLsizei)header.binarySize);
+	GLint linked = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		glDeleteProgram(programID);
+		return 0;
+	}
+	return programID;
+}
+
+bool ProgramCache::store(const std::string& filename, uint64_t key, GLuint programID) {
+	if (!isSupported()) {
+		return false;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return false;
+	}
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(programID, length, &length, &format, binary.data());
+
+	ProgramFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, programMagic, sizeof(programMagic));
+	header.version = programVersion;
+	header.key = key;
+	header.binaryFormat = format;
+	header.binarySize = (uint32_t)length;
+
+	// write to a temporary file and rename it, so a half written binary is never loaded
+	std::string tempFilename = filename + ".tmp";
+	{
+		std::ofstream out(tempFilename, std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) {
+			return false;
+		}
+		out.write((const char*)&header, sizeof(header));
+		out.write(binary.data(), length);
+		if (!out.good()) {
+			out.close();
+			std::remove(tempFilename.c_str());
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempFilename, filename, error);
+	if (error) {
+		std::remove(tempFilename.c_str());
+		return false;
+	}
+	return true;
+}
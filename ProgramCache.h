@@ -0,0 +1,40 @@
+#ifndef _PROGRAM_CACHE_H_
+#define _PROGRAM_CACHE_H_
+
+#include "shader.h"
+#include <stdint.h>
+#include <string>
+
+// Linked program binaries written next to the vertex shader
+// ("shaders/phong.vert" -> "shaders/phong.program"). The key hashes the
+// shader sources together with the GL vendor, renderer and version, so an
+// edited shader or a driver update makes the old binary miss and the
+// program is compiled again. Native byte order.
+struct ProgramFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t binaryFormat;
+	uint32_t binarySize;
+};
+
+class ProgramCache
+{
+private:
+	// 0 unknown, 1 supported, -1 not
+	static int support;
+	static std::string driver;
+
+public:
+	// the driver can hand out program binaries, needs a current context
+	static bool isSupported();
+	static std::string cachePath(const std::string& vertexFilePath);
+	static uint64_t key(const std::string& sources);
+
+	// program created from the stored binary, 0 when missing, stale or rejected
+	static GLuint load(const std::string& filename, uint64_t key);
+	// store a program linked with the retrievable hint
+	static bool store(const std::string& filename, uint64_t key, GLuint programID);
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "RenderQueue.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+
+std::vector<RenderQueue::Item> RenderQueue::items;
+std::vector<RenderQueue::SortEntry> RenderQueue::order;
+std::vector<RenderQueue::Material> RenderQueue::materials;
+RenderQueueStats RenderQueue::counters = { 0, 0, 0, 0 };
+
+uint32_t RenderQueue::findMaterial(const glm::vec3& ambient, const glm::vec3& diffuse, const glm::vec3& specular) {
+	// a handful of materials per frame, a linear search is fine
+	for (size_t i = 0; i < materials.size(); ++i) {
+		const Material& material = materials[i];
+		if (material.ambient == ambient && material.diffuse == diffuse && material.specular == specular) {
+			return (uint32_t)i;
+		}
+	}
+	materials.push_back(Material{ ambient, diffuse, specular });
+	return (uint32_t)materials.size() - 1;
+}
+
+void RenderQueue::add(ShaderProgram* shader, const DrawUniforms* uniforms, GLuint VAO, GLsizei indexCount, GLenum indexType, const void* indexOffset,
+	const glm::mat4& transform, const glm::mat4& model,
+	const glm::vec3& ambient, const glm::vec3& diffuse, const glm::vec3& specular) {
+	uint32_t material = findMaterial(ambient, diffuse, specular);
+	uint64_t key = ((uint64_t)(shader->getID() & 0xffff) << 48) | ((uint64_t)(VAO & 0xffff) << 32) | material;
+	order.push_back(SortEntry{ key, (uint32_t)items.size() });
+	items.push_back(Item{ shader, uniforms, VAO, indexCount, indexType, indexOffset, material, transform, model });
+}
+
+void RenderQueue::flush() {
+	PROFILE_SCOPE("RenderQueue::flush");
+	counters = { items.size(), 0, 0, 0 };
+	if (items.empty()) {
+		materials.clear();
+		return;
+	}
+
+	// ties keep the order they were queued in
+	std::sort(order.begin(), order.end(), [](const SortEntry& a, const SortEntry& b) {
+		return a.key != b.key ? a.key < b.key : a.item < b.item;
+	});
+
+	// Get back correct culling
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+
+	const ShaderProgram* boundShader = nullptr;
+	GLuint boundVAO = 0;
+	uint32_t boundMaterial = UINT32_MAX;
+	for (const auto& entry : order) {
+		const Item& item = items[entry.item];
+		const DrawUniforms& uniforms = *item.uniforms;
+		if (item.shader != boundShader) {
+			item.shader->use();
+			boundShader = item.shader;
+			// uniforms belong to the program, a new one needs the material again
+			boundMaterial = UINT32_MAX;
+			++counters.programBinds;
+		}
+		if (item.VAO != boundVAO) {
+			glBindVertexArray(item.VAO);
+			boundVAO = item.VAO;
+			++counters.vertexArrayBinds;
+		}
+		if (item.material != boundMaterial) {
+			const Material& material = materials[item.material];
+			glUniform3fv(uniforms.ambient, 1, glm::value_ptr(material.ambient));
+			glUniform3fv(uniforms.diffuse, 1, glm::value_ptr(material.diffuse));
+			glUniform3fv(uniforms.specular, 1, glm::value_ptr(material.specular));
+			boundMaterial = item.material;
+			++counters.materialUploads;
+		}
+
+		glUniformMatrix4fv(uniforms.transform, 1, GL_FALSE, glm::value_ptr(item.transform));
+		glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, glm::value_ptr(item.model));
+		glDrawElements(GL_TRIANGLES, item.indexCount, item.indexType, item.indexOffset);
+	}
+
+	// Unbind the VAO and shader program once for the whole queue
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	items.clear();
+	order.clear();
+	materials.clear();
+	Profiler::counter("render state changes", (double)(counters.programBinds + counters.vertexArrayBinds + counters.materialUploads));
+}
+
+void RenderQueue::cleanUp() {
+	items.clear();
+	order.clear();
+	materials.clear();
+}
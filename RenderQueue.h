@@ -0,0 +1,75 @@
+#ifndef _RENDER_QUEUE_H_
+#define _RENDER_QUEUE_H_
+
+#include "ShaderProgram.h"
+#include "Profiler.h"
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+// uniform locations a queued draw writes, resolved by the Geometry once
+struct DrawUniforms {
+	GLint transform, model, ambient, diffuse, specular;
+};
+
+// GL state changes made by the last flush
+struct RenderQueueStats {
+	size_t items;
+	size_t programBinds;
+	size_t vertexArrayBinds;
+	size_t materialUploads;
+};
+
+// Non instanced draws of one frame. Each item gets a 64 bit key, program in
+// the top 16 bits, VAO in the next 16 and material in the low 32, so sorting
+// the keys groups items that share state. flush then only binds a program,
+// VAO or material when it differs from the previous item's, and sets and
+// clears the fixed state once for the whole queue.
+// GL hands out program and VAO names as small integers, so 16 bits hold them
+// in practice. A larger name only loses grouping, flush compares the full
+// program and VAO before skipping a bind.
+class RenderQueue
+{
+private:
+	struct Material {
+		glm::vec3 ambient, diffuse, specular;
+	};
+
+	struct Item {
+		ShaderProgram* shader;
+		const DrawUniforms* uniforms;
+		GLuint VAO;
+		GLsizei indexCount;
+		GLenum indexType;
+		// byte offset of the first index
+		const void* indexOffset;
+		uint32_t material;
+		glm::mat4 transform;
+		glm::mat4 model;
+	};
+
+	// sorted instead of the items, which are too big to move around
+	struct SortEntry {
+		uint64_t key;
+		uint32_t item;
+	};
+
+	static std::vector<Item> items;
+	static std::vector<SortEntry> order;
+	// distinct materials queued this frame, indexed by the low bits of a key
+	static std::vector<Material> materials;
+	static RenderQueueStats counters;
+
+	static uint32_t findMaterial(const glm::vec3& ambient, const glm::vec3& diffuse, const glm::vec3& specular);
+
+public:
+	static void add(ShaderProgram* shader, const DrawUniforms* uniforms, GLuint VAO, GLsizei indexCount, GLenum indexType, const void* indexOffset,
+		const glm::mat4& transform, const glm::mat4& model,
+		const glm::vec3& ambient, const glm::vec3& diffuse, const glm::vec3& specular);
+	// sort the items queued this frame and draw them
+	static void flush();
+	static void cleanUp();
+	static RenderQueueStats stats() { return counters; }
+};
+
+#endif
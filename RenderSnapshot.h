@@ -0,0 +1,50 @@
+#ifndef _RENDER_SNAPSHOT_H_
+#define _RENDER_SNAPSHOT_H_
+
+#include "Frustum.h"
+#include "ParticlePool.h"
+#include <chrono>
+#include <glm/glm.hpp>
+#include <vector>
+
+class Geometry;
+
+// a drawable where the tick left it
+struct SnapshotGeometry {
+	// immutable once placed, and kept alive while a snapshot refers to it (Scene::retire)
+	Geometry* node;
+	// world matrix of the closest Transform above at the end of the tick
+	glm::mat4 world;
+	// its translation when the tick started, frames blend from there to world's
+	glm::vec3 previousPosition;
+	// false while the mesh is still loading, nothing to draw yet
+	bool placed;
+};
+
+// a particle effect where the tick left it
+struct SnapshotParticle {
+	// pool slot, -1 when the effect isn't playing
+	int slot;
+	glm::mat4 world;
+	glm::vec3 previousPosition;
+};
+
+// Everything the render thread needs from one simulation tick, copied out
+// by the simulation thread so rendering never reads the live scene graph.
+// Snapshots are reused, the vectors keep their capacity from tick to tick.
+struct RenderSnapshot {
+	unsigned tick;
+	// when the tick was due, frames are blended by the time passed since
+	std::chrono::steady_clock::time_point time;
+	glm::mat4 view;
+	glm::vec3 eyePos;
+	std::vector<SnapshotGeometry> geometries;
+	// culling bounds at the end of the tick, in the order of geometries
+	CullBounds bounds;
+	std::vector<SnapshotParticle> particles;
+	std::vector<ParticleSlotState> particleSlots;
+
+	RenderSnapshot() : tick(0), view(1), eyePos(0) {}
+};
+
+#endif
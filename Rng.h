@@ -0,0 +1,53 @@
+#ifndef _RNG_H_
+#define _RNG_H_
+
+#include <stdint.h>
+
+// PCG32 (O'Neill, pcg-random.org): 64 bits of state, 32 bit outputs. Every
+// subsystem owns one, seeded from the run's seed with a stream of its own,
+// so a change in how often one of them draws doesn't shift the others and
+// the same seed always gives the same run, unlike the shared rand().
+class Rng
+{
+private:
+	uint64_t state;
+	// odd, selects the stream
+	uint64_t increment;
+
+public:
+	Rng(uint64_t seedValue = 0, uint64_t stream = 0) { seed(seedValue, stream); }
+
+	void seed(uint64_t seedValue, uint64_t stream) {
+		state = 0;
+		increment = (stream << 1) | 1;
+		next();
+		state += seedValue;
+		next();
+	}
+
+	uint32_t next() {
+		uint64_t old = state;
+		state = old * 6364136223846793005ull + increment;
+		uint32_t xorShifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+		uint32_t rotation = (uint32_t)(old >> 59);
+		return (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+	}
+
+	// uniform in [0, bound), without the bias of next() % bound
+	uint32_t below(uint32_t bound) {
+		uint32_t threshold = (0u - bound) % bound;
+		for (;;) {
+			uint32_t value = next();
+			if (value >= threshold) {
+				return value % bound;
+			}
+		}
+	}
+
+	// uniform in [0, 1)
+	float uniform() {
+		return (next() >> 8) * (1.0f / 16777216.0f);
+	}
+};
+
+#endif
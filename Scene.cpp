@@ -0,0 +1,241 @@
+#include "Scene.h"
+#include "Transform.h"
+#include "Geometry.h"
+#include "Particle.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace {
+	// nodes per chunk of a parallel loop
+	const size_t nodeGrain = 256;
+
+	// world alpha of the way through its tick, the position blends and rotation snaps
+	glm::mat4 blend(const glm::mat4& world, const glm::vec3& previousPosition, float alpha) {
+		glm::mat4 blended = world;
+		blended[3] = glm::vec4(glm::mix(previousPosition, glm::vec3(world[3]), alpha), 1);
+		return blended;
+	}
+}
+
+std::atomic<unsigned> Scene::structureVersion(0);
+
+Scene::Scene() :
+	root(nullptr), version(0), recomputedCount(0), boundsStale(false), worldsTick((unsigned)-1), visibleCount(0), culledCount(0), triangleCount(0) {
+}
+
+void Scene::setRoot(Node* node) {
+	root = node;
+	version = structureVersion - 1;
+}
+
+void Scene::refresh() {
+	if (version == structureVersion) {
+		return;
+	}
+	PROFILE_SCOPE("Scene::rebuild");
+
+	transforms.clear();
+	geometries.clear();
+	particles.clear();
+	if (root) {
+		root->flatten(*this, -1);
+	}
+	recomputed.assign(transforms.size(), 0);
+	finished.assign(particles.size(), 0);
+	buildLevels();
+	bounds.resize(geometries.size());
+	boundsStale = true;
+	version = structureVersion;
+}
+
+void Scene::buildLevels() {
+	// parents come before their children, so one pass finds every depth
+	std::vector<uint32_t> depth(transforms.size());
+	levelStart.assign(1, 0);
+	for (size_t i = 0; i < transforms.size(); ++i) {
+		int parent = transforms[i].parent;
+		depth[i] = parent < 0 ? 0 : depth[parent] + 1;
+		if (depth[i] + 2 > levelStart.size()) {
+			levelStart.resize(depth[i] + 2, 0);
+		}
+		++levelStart[depth[i] + 1];
+	}
+
+	// counting sort by depth, keeping the flattened order within a depth
+	for (size_t d = 1; d < levelStart.size(); ++d) {
+		levelStart[d] += levelStart[d - 1];
+	}
+	std::vector<size_t> cursor(levelStart.begin(), levelStart.end() - 1);
+	levelOrder.resize(transforms.size());
+	for (size_t i = 0; i < transforms.size(); ++i) {
+		levelOrder[cursor[depth[i]]++] = (uint32_t)i;
+	}
+}
+
+int Scene::addTransform(Transform* node, int parent) {
+	transforms.push_back(TransformEntry{ node, parent });
+	return (int)transforms.size() - 1;
+}
+
+void Scene::addGeometry(Geometry* node, int parent) {
+	geometries.push_back(GeometryEntry{ node, parent });
+}
+
+void Scene::addParticle(Particle* node, int parent) {
+	particles.push_back(ParticleEntry{ node, parent });
+}
+
+const glm::mat4& Scene::parentWorld(int parent) const {
+	static const glm::mat4 identity(1);
+	return parent < 0 ? identity : transforms[parent].node->getWorld();
+}
+
+glm::vec3 Scene::parentPreviousPosition(int parent) const {
+	return parent < 0 ? glm::vec3(0) : transforms[parent].node->getPreviousPosition();
+}
+
+void Scene::updateWorld(size_t i) {
+	const TransformEntry& entry = transforms[i];
+	bool localChanged = entry.node->takeChange();
+	bool parentChanged = entry.parent >= 0 && recomputed[entry.parent];
+	recomputed[i] = localChanged || parentChanged;
+	if (recomputed[i]) {
+		entry.node->setWorld(parentWorld(entry.parent) * entry.node->getLocal());
+	}
+}
+
+void Scene::updateBounds(size_t i) {
+	Geometry* geometry = geometries[i].node;
+	bounds.set(i, parentWorld(geometries[i].parent), geometry->getBoxMin(), geometry->getBoxMax(), geometry->getSphereRadius());
+}
+
+void Scene::update() {
+	PROFILE_SCOPE("Scene::update");
+	refresh();
+	JobSystem::parallelFor(particles.size(), nodeGrain, [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			finished[i] = particles[i].node->update();
+		}
+	});
+
+	// the pool's free list isn't shared between threads, hand slots back in scene order
+	for (size_t i = 0; i < particles.size(); ++i) {
+		if (finished[i]) {
+			particles[i].node->release();
+		}
+	}
+
+	updateWorlds();
+}
+
+void Scene::updateWorlds() {
+	PROFILE_SCOPE("Scene::updateWorlds");
+	refresh();
+
+	// a depth only needs the worlds of the one above, its transforms can go in any order
+	for (size_t level = 0; level + 1 < levelStart.size(); ++level) {
+		size_t first = levelStart[level];
+		JobSystem::parallelFor(levelStart[level + 1] - first, nodeGrain, [this, first](size_t begin, size_t end) {
+			for (size_t k = first + begin; k < first + end; ++k) {
+				updateWorld(levelOrder[k]);
+			}
+		});
+	}
+	recomputedCount = (size_t)std::count(recomputed.begin(), recomputed.end(), 1);
+
+	// move the bounds of geometries under a changed transform
+	JobSystem::parallelFor(geometries.size(), nodeGrain, [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			int parent = geometries[i].parent;
+			if (boundsStale || (parent >= 0 && recomputed[parent])) {
+				updateBounds(i);
+			}
+		}
+	});
+	boundsStale = false;
+	worldsTick = Transform::tick;
+}
+
+void Scene::capture(RenderSnapshot& snapshot) {
+	PROFILE_SCOPE("Scene::capture");
+	// the first snapshot is taken before any tick ran
+	if (worldsTick != Transform::tick || version != structureVersion) {
+		updateWorlds();
+	}
+
+	// copy out where every drawable is, the render thread never reads the nodes' state
+	snapshot.geometries.resize(geometries.size());
+	JobSystem::parallelFor(geometries.size(), nodeGrain, [this, &snapshot](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			int parent = geometries[i].parent;
+			SnapshotGeometry& out = snapshot.geometries[i];
+			out.node = geometries[i].node;
+			out.world = parentWorld(parent);
+			out.previousPosition = parentPreviousPosition(parent);
+			out.placed = geometries[i].node->isPlaced();
+		}
+	});
+	snapshot.bounds = bounds;
+
+	snapshot.particles.resize(particles.size());
+	for (size_t i = 0; i < particles.size(); ++i) {
+		SnapshotParticle& out = snapshot.particles[i];
+		out.slot = particles[i].node->getSlot();
+		out.world = parentWorld(particles[i].parent);
+		out.previousPosition = parentPreviousPosition(particles[i].parent);
+	}
+}
+
+void Scene::retire(Node* node) {
+	retired.push_back(RetiredNode{ node, Transform::tick });
+}
+
+void Scene::collect(unsigned drawnTick) {
+	size_t kept = 0;
+	for (size_t i = 0; i < retired.size(); ++i) {
+		if (retired[i].tick <= drawnTick) {
+			delete retired[i].node;
+		}
+		else {
+			retired[kept++] = retired[i];
+		}
+	}
+	retired.resize(kept);
+}
+
+void Scene::draw(const RenderSnapshot& snapshot, const glm::mat4& viewProjection, const glm::vec3& eye, float pixelsPerUnit, float alpha) {
+	PROFILE_SCOPE("Scene::draw");
+
+	// the bounds are the ones at the end of the tick, an astro moves a small
+	// fraction of its size per tick
+	{
+		PROFILE_SCOPE("Scene::cull");
+		frustum.extract(viewProjection);
+		visibleCount = frustum.cull(snapshot.bounds, visible);
+		culledCount = snapshot.geometries.size() - visibleCount;
+	}
+	Profiler::counter("geometries visible", (double)visibleCount);
+	Profiler::counter("geometries culled", (double)culledCount);
+
+	// one pixel covers more of an object the further its nearest point is
+	const CullBounds& bounds = snapshot.bounds;
+	triangleCount = 0;
+	for (size_t i = 0; i < snapshot.geometries.size(); ++i) {
+		const SnapshotGeometry& entry = snapshot.geometries[i];
+		if (!visible[i] || !entry.placed) {
+			continue;
+		}
+		float distance = glm::length(glm::vec3(bounds.x[i], bounds.y[i], bounds.z[i]) - eye) - bounds.radius[i];
+		float unitsPerPixel = distance > 0 ? distance / (pixelsPerUnit * bounds.scale[i]) : 0.0f;
+		triangleCount += entry.node->render(blend(entry.world, entry.previousPosition, alpha), unitsPerPixel);
+	}
+	Profiler::counter("triangles drawn", (double)triangleCount);
+
+	// the pool draws every effect at the end of the frame
+	for (const SnapshotParticle& entry : snapshot.particles) {
+		if (entry.slot != -1) {
+			ParticlePool::setTransform(entry.slot, blend(entry.world, entry.previousPosition, alpha));
+		}
+	}
+}
@@ -0,0 +1,127 @@
+#ifndef _SCENE_H_
+#define _SCENE_H_
+
+#include "Frustum.h"
+#include "RenderSnapshot.h"
+#include <atomic>
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+class Node;
+class Transform;
+class Geometry;
+class Particle;
+
+// Flat, depth-first copy of the scene graph, split between the simulation
+// thread and the render thread. On the simulation side it is rebuilt only
+// when nodes are added or removed. At the end of every tick, headless or
+// not, update() walks the transforms one depth at a time, split over the
+// JobSystem's threads. A world matrix is recomputed only when its local
+// matrix changed or its parent's world did, and so are the culling bounds
+// under it. capture() copies the result into a RenderSnapshot.
+// On the render side draw() works from a snapshot only. Positions are
+// blended between the start and end of the tick. Geometries whose bounds
+// are outside the view frustum are skipped, and the rest draw at the level
+// of detail their distance allows. Removed nodes are retired rather than
+// deleted until no snapshot the renderer may still hold refers to them.
+class Scene
+{
+private:
+	struct TransformEntry {
+		Transform* node;
+		// index into transforms, -1 for the root
+		int parent;
+	};
+	struct GeometryEntry {
+		Geometry* node;
+		int parent;
+	};
+	struct ParticleEntry {
+		Particle* node;
+		int parent;
+	};
+	struct RetiredNode {
+		Node* node;
+		// tick it was removed in, snapshots from then on don't have it
+		unsigned tick;
+	};
+
+	// simulation side
+	Node* root;
+	unsigned version;
+	std::vector<TransformEntry> transforms;
+	std::vector<GeometryEntry> geometries;
+	std::vector<ParticleEntry> particles;
+	// per transform, whether its world matrix was recomputed this tick
+	std::vector<char> recomputed;
+	size_t recomputedCount;
+	// transform indices ordered by depth, depth d is levelOrder[levelStart[d] .. levelStart[d + 1])
+	std::vector<uint32_t> levelOrder;
+	std::vector<size_t> levelStart;
+	// per particle, whether its effect ended in the last update
+	std::vector<char> finished;
+	// world bounds of each geometry, in the order of geometries
+	CullBounds bounds;
+	// set when the graph was rebuilt, every bound is recomputed
+	bool boundsStale;
+	// tick the world matrices and bounds were last brought up to date in
+	unsigned worldsTick;
+	std::vector<RetiredNode> retired;
+
+	// render side
+	std::vector<char> visible;
+	Frustum frustum;
+	size_t visibleCount;
+	size_t culledCount;
+	size_t triangleCount;
+
+	void refresh();
+	void buildLevels();
+	// recompute the world matrix of transform i if it or its parent changed
+	void updateWorld(size_t i);
+	void updateBounds(size_t i);
+	// bring world matrices and bounds up to date
+	void updateWorlds();
+	const glm::mat4& parentWorld(int parent) const;
+	glm::vec3 parentPreviousPosition(int parent) const;
+
+	// bumped by every addChild/removeChild, on either thread
+	static std::atomic<unsigned> structureVersion;
+
+public:
+	Scene();
+
+	// only while the simulation thread isn't running
+	void setRoot(Node* root);
+	static void structureChanged() { ++structureVersion; }
+
+	// called by Node::flatten, return the index children refer to
+	int addTransform(Transform* node, int parent);
+	void addGeometry(Geometry* node, int parent);
+	void addParticle(Particle* node, int parent);
+
+	// advance the per tick state of the nodes, particle clocks, then world matrices and bounds
+	void update();
+	// copy what is drawn into snapshot, updating the worlds first if no tick did yet
+	void capture(RenderSnapshot& snapshot);
+	// delete a node already detached from the graph once the renderer is past it
+	void retire(Node* node);
+	// delete the retired nodes no snapshot from drawnTick on refers to
+	void collect(unsigned drawnTick);
+
+	// render thread: draw a snapshot alpha of the way from the start to the
+	// end of its tick. pixelsPerUnit is how many pixels one world unit covers
+	// one unit in front of the eye, it picks the levels of detail.
+	void draw(const RenderSnapshot& snapshot, const glm::mat4& viewProjection, const glm::vec3& eye, float pixelsPerUnit, float alpha);
+
+	size_t transformCount() const { return transforms.size(); }
+	// world matrices recomputed by the last update
+	size_t lastRecomputed() const { return recomputedCount; }
+	// geometries drawn and skipped by the last draw
+	size_t lastVisible() const { return visibleCount; }
+	size_t lastCulled() const { return culledCount; }
+	size_t lastTriangles() const { return triangleCount; }
+};
+
+#endif
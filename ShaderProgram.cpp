@@ -0,0 +1,123 @@
+#include "ShaderProgram.h"
+#include "FrameUniforms.h"
+#include "ProgramCache.h"
+
+namespace {
+	// let the driver compile on as many threads as it likes, once per context
+	void enableParallelCompile() {
+		static bool enabled = false;
+		if (enabled) {
+			return;
+		}
+		enabled = true;
+#if defined(GL_KHR_parallel_shader_compile) && !defined(__APPLE__)
+		if (GLEW_KHR_parallel_shader_compile) {
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		}
+#endif
+	}
+}
+
+ShaderProgram::ShaderProgram(const char* vertexFilePath, const char* fragmentFilePath) :
+	programID(0), cacheKey(0), pending(false), cached(false) {
+	begin(vertexFilePath, fragmentFilePath, {});
+}
+
+ShaderProgram::ShaderProgram(const char* vertexFilePath, const std::vector<const char*>& feedbackVaryings) :
+	programID(0), cacheKey(0), pending(false), cached(false) {
+	begin(vertexFilePath, nullptr, feedbackVaryings);
+}
+
+void ShaderProgram::begin(const char* vertexFilePath, const char* fragmentFilePath, const std::vector<const char*>& feedbackVaryings) {
+	std::string vertexSource, fragmentSource;
+	if (!ReadShaderFile(vertexFilePath, vertexSource) ||
+		(fragmentFilePath && !ReadShaderFile(fragmentFilePath, fragmentSource))) {
+		return;
+	}
+
+	// the varyings are part of the linked program, so they go into the key too
+	std::string sources = vertexSource + '\0' + fragmentSource;
+	for (auto varying : feedbackVaryings) {
+		sources += '\0';
+		sources += varying;
+	}
+	cacheFilename = ProgramCache::cachePath(vertexFilePath);
+	cacheKey = ProgramCache::key(sources);
+
+	programID = ProgramCache::load(cacheFilename, cacheKey);
+	if (programID) {
+		cached = true;
+		pending = true;
+		return;
+	}
+
+	enableParallelCompile();
+	std::cerr << "Compiling " << vertexFilePath << (fragmentFilePath ? " and " : "") << (fragmentFilePath ? fragmentFilePath : "") << std::endl;
+	programID = BeginProgram(vertexSource, fragmentSource, feedbackVaryings, ProgramCache::isSupported());
+	pending = true;
+}
+
+bool ShaderProgram::finish() {
+	if (!pending) {
+		return programID != 0;
+	}
+	pending = false;
+
+	if (!cached) {
+		programID = FinishProgram(programID);
+		if (!programID) {
+			return false;
+		}
+		if (!ProgramCache::store(cacheFilename, cacheKey, programID) && ProgramCache::isSupported()) {
+			std::cerr << "Can't write program cache: " << cacheFilename << std::endl;
+		}
+	}
+	reflect();
+	return true;
+}
+
+ShaderProgram::~ShaderProgram() {
+	if (programID) {
+		glDeleteProgram(programID);
+	}
+}
+
+void ShaderProgram::reflect() {
+	GLint count = 0;
+	GLint maxLength = 0;
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::vector<char> name(maxLength + 1);
+	for (GLint i = 0; i < count; ++i) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(programID, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+		std::string uniformName(name.data(), length);
+
+		// members of uniform blocks have no location
+		GLint location = glGetUniformLocation(programID, uniformName.c_str());
+		if (location < 0) {
+			continue;
+		}
+		uniforms[uniformName] = location;
+
+		// arrays are reported as "name[0]", make them reachable as "name" too
+		auto bracket = uniformName.find('[');
+		if (bracket != std::string::npos) {
+			uniforms[uniformName.substr(0, bracket)] = location;
+		}
+	}
+
+	// attach the shared per-frame block
+	GLuint blockIndex = glGetUniformBlockIndex(programID, FrameUniforms::blockName);
+	if (blockIndex != GL_INVALID_INDEX) {
+		glUniformBlockBinding(programID, blockIndex, FrameUniforms::bindingPoint);
+	}
+}
+
+GLint ShaderProgram::uniform(const std::string& name) const {
+	auto found = uniforms.find(name);
+	return found == uniforms.end() ? -1 : found->second;
+}
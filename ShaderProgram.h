@@ -0,0 +1,51 @@
+#ifndef _SHADER_PROGRAM_H_
+#define _SHADER_PROGRAM_H_
+
+#include "shader.h"
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+// Linked shader program with every active uniform location looked up once
+// at link time. Programs that declare the FrameData block get it bound to
+// FrameUniforms::bindingPoint.
+// The constructor only issues the work: the program comes from the binary
+// in ProgramCache when its key matches, otherwise the compile and link are
+// started without waiting. finish() collects the result, so creating every
+// program before finishing any lets the driver compile them in parallel
+// (KHR_parallel_shader_compile). Freshly linked programs are stored in the
+// cache for the next start.
+class ShaderProgram
+{
+private:
+	GLuint programID;
+	std::unordered_map<std::string, GLint> uniforms;
+	std::string cacheFilename;
+	uint64_t cacheKey;
+	// link issued, result not checked yet
+	bool pending;
+	bool cached;
+
+	void begin(const char* vertexFilePath, const char* fragmentFilePath, const std::vector<const char*>& feedbackVaryings);
+	void reflect();
+
+public:
+	ShaderProgram(const char* vertexFilePath, const char* fragmentFilePath);
+	// vertex only program that writes the listed outputs with transform feedback
+	ShaderProgram(const char* vertexFilePath, const std::vector<const char*>& feedbackVaryings);
+	~ShaderProgram();
+	ShaderProgram(const ShaderProgram&) = delete;
+	ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+	// wait for the link and look up the uniforms, needed before anything else; false on failure
+	bool finish();
+	bool isValid() const { return programID != 0 && !pending; }
+	// loaded from the program binary cache instead of compiled
+	bool fromCache() const { return cached; }
+	GLuint getID() const { return programID; }
+	// location of an active uniform, -1 when the program doesn't use it
+	GLint uniform(const std::string& name) const;
+	void use() const { glUseProgram(programID); }
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "Simulation.h"
+#include "Window.h"
+
+std::thread Simulation::thread;
+std::atomic<bool> Simulation::running(false);
+std::atomic<bool> Simulation::finished(false);
+TripleBuffer<RenderSnapshot> Simulation::snapshots;
+std::atomic<unsigned> Simulation::drawnTick(0);
+std::mutex Simulation::inputMutex;
+std::vector<InputEvent> Simulation::input;
+
+void Simulation::start() {
+	if (running) {
+		return;
+	}
+
+	// the renderer has something to draw from its first frame
+	publish(std::chrono::steady_clock::now());
+	snapshots.acquire();
+	drawnTick = snapshots.front().tick;
+	finished = InputRecorder::replayFinished(Transform::tick);
+
+	running = true;
+	thread = std::thread(run);
+}
+
+void Simulation::stop() {
+	running = false;
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+void Simulation::publish(std::chrono::steady_clock::time_point due) {
+	RenderSnapshot& snapshot = snapshots.back();
+	Window::captureSnapshot(snapshot);
+	snapshot.time = due;
+	snapshots.publish();
+}
+
+void Simulation::run() {
+	Profiler::setThreadName("simulation");
+	auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(Window::tickLength));
+	auto due = std::chrono::steady_clock::now() + period;
+	std::vector<InputEvent> events;
+
+	while (running.load(std::memory_order_acquire)) {
+		auto now = std::chrono::steady_clock::now();
+		if (now < due) {
+			std::this_thread::sleep_until(due);
+			continue;
+		}
+		// Don't try to catch up on long stalls (breakpoint), just slow down.
+		if (now - due > std::chrono::milliseconds(250)) {
+			due = now;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(inputMutex);
+			events.swap(input);
+		}
+		for (const InputEvent& event : events) {
+			Window::applyLiveInput(event);
+		}
+		events.clear();
+
+		Window::idleCallback();
+		publish(due);
+		due += period;
+
+		if (InputRecorder::replayFinished(Transform::tick)) {
+			finished = true;
+			return;
+		}
+	}
+}
+
+void Simulation::post(const InputEvent& event) {
+	std::lock_guard<std::mutex> lock(inputMutex);
+	input.push_back(event);
+}
+
+const RenderSnapshot& Simulation::acquire() {
+	// the old front is free for the simulation from here on
+	if (snapshots.acquire()) {
+		drawnTick.store(snapshots.front().tick, std::memory_order_release);
+	}
+	return snapshots.front();
+}
+
+float Simulation::blendFactor(const RenderSnapshot& snapshot) {
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - snapshot.time).count();
+	return (float)glm::clamp(seconds / Window::tickLength, 0.0, 1.0);
+}
@@ -0,0 +1,53 @@
+#ifndef _SIMULATION_H_
+#define _SIMULATION_H_
+
+#include "InputRecorder.h"
+#include "RenderSnapshot.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs the fixed step simulation on a thread of its own while the main
+// thread renders, so a frame costs about the slower of the two instead of
+// their sum. After every tick what is drawn is captured into a
+// RenderSnapshot and published through a triple buffer, and the renderer
+// always draws the newest one without waiting for the simulation. Input
+// from the GLFW callbacks is queued and applied at the start of the next
+// tick, the way a recording is replayed.
+class Simulation
+{
+private:
+	static std::thread thread;
+	static std::atomic<bool> running;
+	// a replay went through every recorded tick
+	static std::atomic<bool> finished;
+	static TripleBuffer<RenderSnapshot> snapshots;
+	// tick of the snapshot the renderer holds, nodes retired up to it can go
+	static std::atomic<unsigned> drawnTick;
+	static std::mutex inputMutex;
+	static std::vector<InputEvent> input;
+
+	static void run();
+	static void publish(std::chrono::steady_clock::time_point due);
+
+public:
+	// capture the first snapshot and start ticking, after initializeObjects
+	static void start();
+	// finish the current tick and join the thread
+	static void stop();
+
+	// main thread: queue input for the next tick
+	static void post(const InputEvent& event);
+	// render thread: the newest snapshot, untouched until the next call
+	static const RenderSnapshot& acquire();
+	// render thread: how far time is from the snapshot's tick to the next, 0 to 1
+	static float blendFactor(const RenderSnapshot& snapshot);
+	static bool isFinished() { return finished.load(); }
+	// simulation thread: tick of the snapshot the renderer holds
+	static unsigned oldestDrawnTick() { return drawnTick.load(std::memory_order_acquire); }
+};
+
+#endif
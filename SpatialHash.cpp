@@ -0,0 +1,31 @@
+#include "SpatialHash.h"
+
+SpatialHash::SpatialHash(float cellSize) :
+	cellSize(cellSize), bucketMask(0) {
+}
+
+void SpatialHash::build(const float* x, const float* z, size_t count) {
+	// about two buckets per entry keeps collisions between cells rare
+	uint32_t bucketCount = 16;
+	while (bucketCount < count * 2) {
+		bucketCount *= 2;
+	}
+	bucketMask = bucketCount - 1;
+
+	bucketStart.assign(bucketCount + 1, 0);
+	bucketOf.resize(count);
+	entries.resize(count);
+
+	// counting sort: count per bucket, prefix sum, then scatter
+	for (size_t i = 0; i < count; ++i) {
+		bucketOf[i] = bucket(cell(x[i]), cell(z[i]));
+		++bucketStart[bucketOf[i] + 1];
+	}
+	for (uint32_t b = 0; b < bucketCount; ++b) {
+		bucketStart[b + 1] += bucketStart[b];
+	}
+	cursor.assign(bucketStart.begin(), bucketStart.end() - 1);
+	for (size_t i = 0; i < count; ++i) {
+		entries[cursor[bucketOf[i]]++] = (uint32_t)i;
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef _SPATIAL_HASH_H_
+#define _SPATIAL_HASH_H_
+
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+// Uniform grid over the xz plane, hashed into a fixed number of buckets.
+// Rebuilt from scratch with a counting sort, so building is O(n) and a query
+// only looks at the 3x3 cells around a point. The cell size has to be at
+// least the largest query radius.
+class SpatialHash
+{
+private:
+	float cellSize;
+	uint32_t bucketMask;
+	// entries[bucketStart[b] .. bucketStart[b + 1]) are the ids in bucket b
+	std::vector<uint32_t> bucketStart;
+	std::vector<uint32_t> entries;
+	std::vector<uint32_t> bucketOf;
+	std::vector<uint32_t> cursor;
+
+	uint32_t bucket(int cellX, int cellZ) const {
+		// large primes spread neighbouring cells over the table
+		uint32_t hash = (uint32_t)cellX * 73856093u ^ (uint32_t)cellZ * 19349663u;
+		return hash & bucketMask;
+	}
+	int cell(float coordinate) const { return (int)glm::floor(coordinate / cellSize); }
+
+public:
+	SpatialHash(float cellSize);
+
+	void build(const float* x, const float* z, size_t count);
+
+	// call visit(id) for every id stored near point, stop early when visit returns false
+	template <typename Visitor>
+	void query(const glm::vec2& point, Visitor visit) const {
+		if (entries.empty()) {
+			return;
+		}
+
+		int centerX = cell(point.x);
+		int centerZ = cell(point.y);
+		// different cells can share a bucket, only walk each bucket once
+		uint32_t visited[9];
+		int visitedCount = 0;
+		for (int dz = -1; dz <= 1; ++dz) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				uint32_t b = bucket(centerX + dx, centerZ + dz);
+				bool seen = false;
+				for (int i = 0; i < visitedCount; ++i) {
+					seen = seen || visited[i] == b;
+				}
+				if (seen) {
+					continue;
+				}
+				visited[visitedCount++] = b;
+
+				for (uint32_t i = bucketStart[b]; i < bucketStart[b + 1]; ++i) {
+					if (!visit(entries[i])) {
+						return;
+					}
+				}
+			}
+		}
+	}
+};
+
+#endif
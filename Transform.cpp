@@ -1,7 +1,10 @@
 #include "Transform.h"
 
+unsigned int Transform::tick = 0;
+
 Transform::Transform(const glm::mat4& transMatrix) :
-      transform(transMatrix), dirRecord(transform), speed(0) {
+      transform(transMatrix), dirRecord(transform), speed(0),
+      world(1), previousPosition(0), worldTick(-1), hasWorld(false), dirty(true) {
 }
 
 Transform::~Transform() {
@@ -10,38 +13,62 @@ Transform::~Transform() {
       }
 }
 
-void Transform::draw(const glm::mat4& C) {
+void Transform::flatten(Scene& scene, int parent) {
+      int index = scene.addTransform(this, parent);
       for (auto child : children) {
-            child->draw(C * transform);
+            child->flatten(scene, index);
       }
 }
 
-void Transform::update() {
-      for (auto child : children) {
-            child->update();
+void Transform::setWorld(const glm::mat4& matrix) {
+      // a new node starts where it is instead of sliding in from the origin
+      if (!hasWorld) {
+            previousPosition = glm::vec3(matrix[3]);
+            hasWorld = true;
       }
+      else if (worldTick != tick) {
+            previousPosition = glm::vec3(world[3]);
+      }
+      worldTick = tick;
+      world = matrix;
 }
 
 void Transform::addChild(Node* child) {
       children.push_back(child);
+      Scene::structureChanged();
 }
 
 void Transform::removeChild(Node* child) {
       delete child;
       children.remove(child);
+      Scene::structureChanged();
 }
 
+void Transform::detachChild(Node* child) {
+      children.remove(child);
+      Scene::structureChanged();
+}
 
 void Transform::move(float angle) {
+      dirty = true;
       transform = glm::translate(glm::vec3(speed * glm::sin(angle), 0, speed * glm::cos(angle))) * transform;
 }
 
 void Transform::face(float angle) {
-      transform = glm::rotate(glm::mat4(1), angle, glm::vec3(0, 1, 0)) * dirRecord;
+      glm::mat4 faced = glm::rotate(glm::mat4(1), angle, glm::vec3(0, 1, 0)) * dirRecord;
+      if (faced == transform) {
+            return;
+      }
+      dirty = true;
+      transform = faced;
 }
 
-glm::vec3 Transform::getLocation() {
-      return glm::vec3(transform * glm::vec4(0, 0, 0, 1));
+void Transform::setLocation(const glm::vec3& location) {
+      if (glm::vec3(transform[3]) == location) {
+            return;
+      }
+      dirty = true;
+      transform[3] = glm::vec4(location, 1);
 }
 
 void Transform::toggleMove() {
@@ -15,17 +15,43 @@ private:
 	float speed;
 	std::list<Node*> children;
 
+	// cached parent * local, its translation when the tick started and the
+	// tick it last changed in
+	glm::mat4 world;
+	glm::vec3 previousPosition;
+	unsigned int worldTick;
+	bool hasWorld;
+	// local transform changed since the world matrix was last computed
+	bool dirty;
+
 public:
+	// simulation tick counter
+	static unsigned int tick;
+
 	Transform(const glm::mat4& transMatrix);
 	~Transform();
-	void draw(const glm::mat4& C);
-	void update();
+	void flatten(Scene& scene, int parent);
 	void addChild(Node* child);
 	void removeChild(Node* child);
+	// unlink child without deleting it, see Scene::retire
+	void detachChild(Node* child);
 	void move(float angle);
 	void face(float angle);
-	glm::vec3 getLocation();
+	glm::vec3 getLocation() const { return glm::vec3(transform[3]); }
+	void setLocation(const glm::vec3& location);
 	void toggleMove();
+
+	// true once if the local matrix changed since the last call
+	bool takeChange() {
+		bool changed = dirty;
+		dirty = false;
+		return changed;
+	}
+	const glm::mat4& getLocal() const { return transform; }
+	const glm::mat4& getWorld() const { return world; }
+	void setWorld(const glm::mat4& matrix);
+	// world translation when the current tick started
+	glm::vec3 getPreviousPosition() const { return worldTick == tick ? previousPosition : glm::vec3(world[3]); }
 };
 
 #endif
@@ -0,0 +1,49 @@
+#ifndef _TRIPLE_BUFFER_H_
+#define _TRIPLE_BUFFER_H_
+
+#include <atomic>
+
+// Hands the newest of a stream of values from one writer thread to one
+// reader thread without locks. The writer fills back() and publishes it,
+// which swaps it with the middle buffer; the reader swaps the middle buffer
+// with its front one whenever something newer was published. Neither side
+// ever waits, and the reader always gets the latest complete value,
+// skipping the ones it was too slow for.
+template <typename T>
+class TripleBuffer
+{
+private:
+	// set on the middle index when the writer put it there after the last acquire
+	static const unsigned freshBit = 4;
+
+	T buffers[3];
+	std::atomic<unsigned> middle;
+	// only the writer touches backIndex, only the reader frontIndex
+	unsigned backIndex;
+	unsigned frontIndex;
+
+public:
+	TripleBuffer() : middle(1), backIndex(0), frontIndex(2) {}
+
+	// writer: the buffer to fill next
+	T& back() { return buffers[backIndex]; }
+	// writer: make back() the newest value and get another buffer to fill
+	void publish() {
+		unsigned previous = middle.exchange(backIndex | freshBit, std::memory_order_acq_rel);
+		backIndex = previous & ~freshBit;
+	}
+
+	// reader: take over the newest value, false when front() is still the newest
+	bool acquire() {
+		if (!(middle.load(std::memory_order_relaxed) & freshBit)) {
+			return false;
+		}
+		unsigned previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+		frontIndex = previous & ~freshBit;
+		return true;
+	}
+	// reader: the value taken by the last acquire, stays untouched until the next
+	const T& front() const { return buffers[frontIndex]; }
+};
+
+#endif
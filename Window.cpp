@@ -1,4 +1,8 @@
 #include "Window.h"
+#include "Simulation.h"
+
+#include <algorithm>
+#include <chrono>
 
 // Window Properties
 int Window::width;
@@ -8,20 +12,57 @@ const char* Window::windowTitle = "GLFW Starter Project";
 // Objects to Render
 //Sphere* Window::disco;
 Transform* Window::world;
-Geometry* Window::lobby;
+Scene Window::scene;
+Transform* Window::lobby;
 Transform* Window::playerAstroMoveControl;
 Transform* Window::playerAstroFaceControl;
-std::vector<Transform*> Window::computerAstroMoveList;
-std::vector<Transform*> Window::computerAstroFaceList;
-std::vector<Particle*> Window::particleList;
-std::vector<float> Window::angleList;
-std::vector<int> Window::colorIndexList;
+AgentStore Window::agents;
+size_t Window::maxComputerAstros = 10;
+const float Window::astroHeight = -4.3f;
+int Window::particleCount = 150;
+int Window::particleSlots = 32;
+unsigned Window::loaderThreads = 2;
+unsigned Window::jobThreads = 0;
+const size_t Window::agentGrain = 256;
+
+// both effects last as long as the 200 tick remove delay
+EmitterSettings Window::spawnEffect = {
+	glm::vec3(0, 1, 1), 2.0f,
+	1.0f, 1.0f, glm::vec3(0, 1, 0), 0.5f,
+	glm::radians(300.0f), 0.0f, 1.0f, 200.0f / 60.0f
+};
+EmitterSettings Window::despawnEffect = {
+	glm::vec3(1, 0, 0), 3.0f,
+	1.5f, 2.0f, glm::vec3(0, -0.5f, 0), 0.5f,
+	glm::radians(-300.0f), 0.0f, 1.0f, 200.0f / 60.0f
+};
+const int Window::spawnAttempts = 100;
+
+bool Window::headless = false;
+unsigned Window::seed = (unsigned)time(NULL);
+Rng Window::spawnRng;
+Rng Window::removeRng;
+Rng Window::wanderRng;
+
+// Collision broad phase, cells must be at least the 2 unit contact distance
+// plus how far an astro can move during one tick
+glm::vec2 Window::playerPosition;
+SpatialHash Window::astroGrid(2.5f);
+CollisionWorld Window::lobbyColliders;
+std::vector<Contact> Window::lobbyContacts;
+std::vector<float> Window::astroReflections;
+const float Window::astroRadius = 1.1f;
+
+// Simulation runs at 60 ticks per second
+const double Window::tickLength = 1.0 / 60.0;
+TickTimings Window::tickTimings;
 
 int Window::removeDelay = 200;
 int Window::indexToRemove = -1;
 
 // Track key pressed
 KeyRecord Window::keyPressed;
+KeyRecord Window::playerKeys;
 
 // Camera Matrices 
 // Projection matrix:
@@ -57,66 +98,147 @@ std::vector<glm::vec3> Window::colorList({
 
 std::vector<bool> Window::colorStatus(12, false);
 
-// Shader Program ID
-GLuint Window::phongShader; 
-GLuint Window::toonShader; 
-GLuint Window::particleShader;
+// Shader Programs
+ShaderProgram* Window::phongShader;
+ShaderProgram* Window::toonShader;
+ShaderProgram* Window::particleShader;
+ShaderProgram* Window::particleUpdateShader;
+
+// project a scene position onto the floor plane used for collision
+static glm::vec2 xz(const glm::vec3& location) {
+	return glm::vec2(location.x, location.z);
+}
+
+// seconds since the last call, restarting the clock
+static double lap(std::chrono::steady_clock::time_point& start) {
+	auto now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - start).count();
+	start = now;
+	return seconds;
+}
 
 bool Window::initializeProgram() {
+	auto start = std::chrono::steady_clock::now();
+
 	// Create a shader program with a vertex shader and a fragment shader.
-	phongShader = LoadShaders("shaders/phong.vert", "shaders/phong.frag");
-	toonShader = LoadShaders("shaders/toon.vert", "shaders/toon.frag");
-	particleShader = LoadShaders("shaders/particle.vert", "shaders/particle.frag");
+	// Every compile and link is issued before any result is read, so the
+	// driver can work on all of them at once.
+	phongShader = new ShaderProgram("shaders/phong.vert", "shaders/phong.frag");
+	toonShader = new ShaderProgram("shaders/toon.vert", "shaders/toon.frag");
+	particleShader = new ShaderProgram("shaders/particle.vert", "shaders/particle.frag");
+	particleUpdateShader = new ShaderProgram("shaders/particle_update.vert", { "outPosition", "outVelocity", "outLife" });
 
 	// Check the shader program.
-	if (!phongShader || !toonShader || !particleShader)
+	bool linked = true;
+	int fromCache = 0;
+	for (auto program : { phongShader, toonShader, particleShader, particleUpdateShader }) {
+		linked = program->finish() && linked;
+		fromCache += program->fromCache();
+	}
+	if (!linked)
 	{
 		std::cerr << "Failed to initialize shader program" << std::endl;
 		return false;
 	}
+	std::cerr << "Shaders ready in " << lap(start) * 1000.0 << " ms, " << fromCache << " of 4 from the program cache" << std::endl;
+
+	// Camera and light uniforms shared by all programs.
+	FrameUniforms::init();
+
+	// GPU passes can be timed now that there is a context.
+	Profiler::gpuTiming = true;
 
 	return true;
 }
 
 bool Window::initializeObjects()
 {
-	// initialize random
-	srand(time(NULL));
+	// initialize random, one stream per subsystem
+	spawnRng.seed(seed, 1);
+	removeRng.seed(seed, 2);
+	wanderRng.seed(seed, 3);
+
+	// the main thread works on every parallel loop too
+	unsigned threads = jobThreads > 0 ? jobThreads : std::thread::hardware_concurrency();
+	JobSystem::start(threads > 1 ? threads - 1 : 0);
+
+	// walls and props the astros bounce off
+	if (!lobbyColliders.load("models/amongus_lobby.colliders")) {
+		return false;
+	}
 
 	// initialize scene graph of the ride
 	world = new Transform(glm::mat4(1));
 	auto world2Lobby = new Transform(glm::mat4(1));
-	auto mainLobby = new Geometry("models/amongus_lobby.obj", phongShader, glm::vec3(0.2), glm::vec3(0.8, 0.8, 0.9), glm::vec3(0.2), glm::vec3(1));
-	auto lobby2Astro = new Transform(glm::translate(glm::vec3(0, -4.3, 2)));
+	auto lobby2Astro = new Transform(glm::translate(glm::vec3(0, astroHeight, 2)));
 	auto astroFace = new Transform(glm::mat4(1));
-	auto astro = new Geometry("models/amongus_astro_still.obj", toonShader, glm::vec3(0.1), colorList[5], glm::vec3(0), glm::vec3(1));
 	colorStatus[5] = true;
 	lobby2Astro->toggleMove();
 
-	auto particle = new Particle(particleShader, glm::vec3(0, 1, 1), 150, 2);
+	// every particle effect plays in a slot of one preallocated pool
+	ParticlePool::tickSeconds = (float)tickLength;
+	if (!ParticlePool::init(particleSlots, particleCount, particleShader, particleUpdateShader)) {
+		return false;
+	}
+
+	auto particle = new Particle(spawnEffect);
 	
 	world->addChild(world2Lobby);
-	world2Lobby->addChild(mainLobby);
-	mainLobby->addChild(lobby2Astro);
+	world2Lobby->addChild(lobby2Astro);
 	lobby2Astro->addChild(astroFace);
 	lobby2Astro->addChild(particle);
-	astroFace->addChild(astro);
 
-	lobby = mainLobby;
+	// meshes only exist with a GL context, they load in the background
+	if (!headless) {
+		AssetLoader::start(loaderThreads);
+		auto mainLobby = new Geometry("models/amongus_lobby.obj", phongShader, glm::vec3(0.2), glm::vec3(0.8, 0.8, 0.9), glm::vec3(0.2), glm::vec3(1));
+		auto astro = new Geometry("models/amongus_astro_still.obj", toonShader, glm::vec3(0.1), colorList[5], glm::vec3(0), glm::vec3(1), true);
+		world2Lobby->addChild(mainLobby);
+		astroFace->addChild(astro);
+	}
+
+	lobby = world2Lobby;
 	playerAstroMoveControl = lobby2Astro;
 	playerAstroFaceControl = astroFace;
+	scene.setRoot(world);
+
+	// the lobby is there from the first frame, astros added later pop in when loaded
+	AssetLoader::waitAll();
 	return true;
 }
 
 void Window::cleanUp()
 {
 	// Deallcoate the objects.
+	scene.setRoot(nullptr);
 	delete world;
+	scene.collect(-1);
+	ParticlePool::cleanUp();
+	JobSystem::stop();
+
+	// forget the astros, initializeObjects can start over after this
+	agents.clear();
+	std::fill(colorStatus.begin(), colorStatus.end(), false);
+	removeDelay = 200;
+	indexToRemove = -1;
+	if (headless) {
+		return;
+	}
+	RenderQueue::cleanUp();
+	InstancedRenderer::cleanUp();
+
+	// Release the shared mesh buffers while the context is still alive.
+	AssetLoader::stop();
+	MeshCache::clear();
+
+	Profiler::cleanUp();
 
 	// Delete the shader program.
-	glDeleteProgram(phongShader);
-	glDeleteProgram(toonShader);
-	glDeleteProgram(particleShader);
+	delete phongShader;
+	delete toonShader;
+	delete particleShader;
+	delete particleUpdateShader;
+	FrameUniforms::cleanUp();
 }
 
 GLFWwindow* Window::createWindow(int width, int height)
@@ -196,17 +318,35 @@ void Window::resizeCallback(GLFWwindow* window, int width, int height)
 // Perform any necessary updates here 
 void Window::idleCallback()
 {
+	// start a new tick, transforms changed from here on blend from where they are now
+	++Transform::tick;
+	PROFILE_SCOPE("idleCallback");
+	auto start = std::chrono::steady_clock::now();
+
+	// a replay takes its input from the recording
+	while (const InputEvent* event = InputRecorder::nextEvent(Transform::tick)) {
+		applyInput(*event);
+	}
+
+	// cache positions and bucket them for collision queries
+	buildAstroGrid();
+	tickTimings.collision += lap(start);
+
 	// move according to key pressed
 	playerMovement();
 	// move computer astros
 	computerMovement();
+	tickTimings.movement += lap(start);
+
+	computerCollision();
+	tickTimings.collision += lap(start);
 
-	int toggleRandom = rand() % 100;
+	int toggleRandom = wanderRng.below(100);
 	if (toggleRandom < 5) {
 		randomToggle();
 	}
 
-	int addRandom = rand() % 100;
+	int addRandom = spawnRng.below(100);
 	if (addRandom < 3) {
 		randomAdd();
 	}
@@ -215,51 +355,83 @@ void Window::idleCallback()
             randomRemove();
 	}
 	else {
-            int removeRandom = rand() % 200;
+            int removeRandom = removeRng.below(200);
             if (removeRandom < 1) {
                   randomRemove();
             }
 	}
+	tickTimings.spawn += lap(start);
 
 	// update all objects in scene graph
-	world->update();
+	syncAgentNodes();
+	{
+		PROFILE_SCOPE("scene update");
+		scene.update();
+		// without a renderer nothing holds on to removed astros
+		scene.collect(headless ? Transform::tick : Simulation::oldestDrawnTick());
+	}
+	tickTimings.scene += lap(start);
 }
 
-void Window::displayCallback(GLFWwindow* window)
+void Window::captureSnapshot(RenderSnapshot& snapshot)
+{
+	snapshot.tick = Transform::tick;
+	snapshot.view = view;
+	snapshot.eyePos = eyePos;
+	scene.capture(snapshot);
+	snapshot.particleSlots = ParticlePool::state();
+}
+
+void Window::displayCallback(GLFWwindow* window, const RenderSnapshot& snapshot, float alpha)
 {	
+	PROFILE_SCOPE("displayCallback");
+
 	// Clear the color and depth buffers
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);	
 
 	// Render the objects
-	glUseProgram(phongShader);
-	glUniformMatrix4fv(glGetUniformLocation(phongShader, "view"), 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(glGetUniformLocation(phongShader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-	glUniform3fv(glGetUniformLocation(phongShader, "eyePos"), 1, glm::value_ptr(eyePos));
-	glUniform3fv(glGetUniformLocation(phongShader, "lightPos"), 1, glm::value_ptr(lightPos));
-	glUniform3fv(glGetUniformLocation(phongShader, "lightColor"), 1, glm::value_ptr(lightColor));
-
-	glUseProgram(toonShader);
-	glUniformMatrix4fv(glGetUniformLocation(toonShader, "view"), 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(glGetUniformLocation(toonShader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-	glUniform3fv(glGetUniformLocation(toonShader, "eyePos"), 1, glm::value_ptr(eyePos));
-	glUniform3fv(glGetUniformLocation(toonShader, "lightPos"), 1, glm::value_ptr(lightPos));
-	glUniform3fv(glGetUniformLocation(toonShader, "lightColor"), 1, glm::value_ptr(lightColor));
-
-	glUseProgram(particleShader);
-	glUniformMatrix4fv(glGetUniformLocation(particleShader, "view"), 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(glGetUniformLocation(particleShader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-	// call draw on scene graph
-	world->draw(glm::mat4(1));
+	// Upload camera and light once for every program
+	FrameUniforms::update(snapshot.view, projection, snapshot.eyePos, lightPos, lightColor);
+
+	// make meshes finished by the loader threads resident, a few per frame
+	AssetLoader::pump();
+
+	// queue the visible part of the snapshot, drawn between the last two ticks, then draw it sorted by state
+	{
+		PROFILE_GPU_SCOPE("scene graph");
+		scene.draw(snapshot, projection * snapshot.view, snapshot.eyePos, projection[1][1] * height * 0.5f, alpha);
+		RenderQueue::flush();
+	}
+
+	// draw the crewmates gathered during the traversal, one call per mesh
+	{
+		PROFILE_GPU_SCOPE("instanced");
+		InstancedRenderer::flush();
+	}
+
+	// advance and draw every particle effect at once
+	{
+		PROFILE_GPU_SCOPE("particles");
+		ParticlePool::flush(snapshot.particleSlots, snapshot.tick);
+	}
 
 	// Gets events, including input such as keyboard and mouse or window resizing
-	glfwPollEvents();
+	{
+		PROFILE_SCOPE("glfwPollEvents");
+		glfwPollEvents();
+	}
 
 	// Swap buffers.
-	glfwSwapBuffers(window);
+	{
+		PROFILE_SCOPE("glfwSwapBuffers");
+		glfwSwapBuffers(window);
+	}
 }
 
 void Window::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+	uint8_t previousKeys = movementKeys();
+
 	// Check for a key press.
 	if (action == GLFW_PRESS || action == GLFW_REPEAT)
 	{
@@ -286,6 +458,20 @@ void Window::keyCallback(GLFWwindow* window, int key, int scancode, int action,
 			keyPressed.dPressed = true;
 			break;
 
+		case GLFW_KEY_P:
+			// print where frame time goes once a second
+			if (action == GLFW_PRESS) {
+				Profiler::setReporting(!Profiler::isReporting());
+			}
+			break;
+
+		case GLFW_KEY_T:
+			// record the next two seconds as a Chrome trace
+			if (action == GLFW_PRESS && !Profiler::isCapturing()) {
+				Profiler::captureTrace("profile.json", 120);
+			}
+			break;
+
 		default:
 			break;
 		}
@@ -297,66 +483,140 @@ void Window::keyCallback(GLFWwindow* window, int key, int scancode, int action,
 		keyPressed.sPressed = false;
 		keyPressed.dPressed = false;
 	}
+
+	// the simulation thread takes the change at its next tick
+	if (movementKeys() != previousKeys) {
+		Simulation::post(InputEvent{ 0, InputEvent::Keys, movementKeys(), 0, 0, 0.0f });
+	}
+}
+
+uint8_t Window::movementKeys() {
+	return (keyPressed.wPressed ? 1 : 0) | (keyPressed.aPressed ? 2 : 0) | (keyPressed.sPressed ? 4 : 0) | (keyPressed.dPressed ? 8 : 0);
+}
+
+void Window::applyInput(const InputEvent& event) {
+	if (event.type == InputEvent::Keys) {
+		playerKeys.wPressed = (event.keys & 1) != 0;
+		playerKeys.aPressed = (event.keys & 2) != 0;
+		playerKeys.sPressed = (event.keys & 4) != 0;
+		playerKeys.dPressed = (event.keys & 8) != 0;
+	}
+	else if (event.type == InputEvent::Camera) {
+		rotateCamera(event.degrees, event.axis);
+	}
+}
+
+void Window::applyLiveInput(const InputEvent& event) {
+	// a replay only takes input from the recording
+	if (InputRecorder::isReplaying()) {
+		return;
+	}
+	applyInput(event);
+
+	// recorded for the tick about to run, the one it takes effect in
+	if (event.type == InputEvent::Keys) {
+		InputRecorder::recordKeys(Transform::tick + 1, event.keys);
+	}
+	else {
+		InputRecorder::recordCamera(Transform::tick + 1, event.degrees, event.axis);
+	}
 }
 
 // control key movement
 void Window::playerMovement() {
-	if (keyPressed.wPressed) {
+	PROFILE_SCOPE("playerMovement");
+	if (playerKeys.wPressed) {
 		float angle = glm::radians(180.0);
 		playerAstroMoveControl->move(angle);
 		playerAstroFaceControl->face(angle);
 		if (lobbyCollide(playerAstroMoveControl->getLocation(), angle) != 10.0 ||
-			astroCollide(playerAstroMoveControl->getLocation(), angle) != 10.0) {
+			astroCollide(-1, xz(playerAstroMoveControl->getLocation()), angle) != 10.0) {
                   playerAstroMoveControl->move(glm::radians(0.0f));
 		}
-	} else if (keyPressed.aPressed) {
+	} else if (playerKeys.aPressed) {
 		float angle = glm::radians(270.0);
 		playerAstroMoveControl->move(angle);
 		playerAstroFaceControl->face(angle);
 		if (lobbyCollide(playerAstroMoveControl->getLocation(), angle) != 10.0 ||
-			astroCollide(playerAstroMoveControl->getLocation(), angle) != 10.0) {
+			astroCollide(-1, xz(playerAstroMoveControl->getLocation()), angle) != 10.0) {
                   playerAstroMoveControl->move(glm::radians(90.0f));
 		}
-	} else if (keyPressed.sPressed) {
+	} else if (playerKeys.sPressed) {
 		float angle = glm::radians(0.0);
 		playerAstroMoveControl->move(angle);
 		playerAstroFaceControl->face(angle);
 		if (lobbyCollide(playerAstroMoveControl->getLocation(), angle) != 10.0 ||
-			astroCollide(playerAstroMoveControl->getLocation(), angle) != 10.0) {
+			astroCollide(-1, xz(playerAstroMoveControl->getLocation()), angle) != 10.0) {
                   playerAstroMoveControl->move(glm::radians(180.0f));
 		}
-	} else if (keyPressed.dPressed) {
+	} else if (playerKeys.dPressed) {
 		float angle = glm::radians(90.0);
 		playerAstroMoveControl->move(angle);
 		playerAstroFaceControl->face(angle);
 		if (lobbyCollide(playerAstroMoveControl->getLocation(), angle) != 10.0 ||
-			astroCollide(playerAstroMoveControl->getLocation(), angle) != 10.0) {
+			astroCollide(-1, xz(playerAstroMoveControl->getLocation()), angle) != 10.0) {
                   playerAstroMoveControl->move(glm::radians(270.0f));
 		}
 	}
 
       view = glm::lookAt(Window::eyePos, Window::lookAtPoint, Window::upVector);
+      playerPosition = xz(playerAstroMoveControl->getLocation());
 }
 
 void Window::computerMovement() {
-	for (int i = 0; i < computerAstroMoveList.size(); ++i) {
-		computerAstroMoveList[i]->move(angleList[i]);
-		computerAstroFaceList[i]->face(angleList[i]);
-
-		float astroReflectAngle = astroCollide(computerAstroMoveList[i]->getLocation(), angleList[i]);
-		if (astroReflectAngle != 10.0) {
-			angleList[i] = astroReflectAngle;
-                  computerAstroMoveList[i]->move(angleList[i]);
-                  computerAstroFaceList[i]->face(angleList[i]);
+	PROFILE_SCOPE("computerMovement");
+	// move every astro along its heading, in chunks on all threads
+	JobSystem::parallelFor(agents.size(), agentGrain, [](size_t begin, size_t end) {
+		agents.integrate(begin, end);
+	});
+}
+
+void Window::computerCollision() {
+	PROFILE_SCOPE("computerCollision");
+	// every astro checks where the others are after moving before any of
+	// them bounces, so the outcome doesn't depend on the order (or thread)
+	// they are handled in
+	size_t count = agents.size();
+	astroReflections.resize(count);
+	JobSystem::parallelFor(count, agentGrain, [](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			astroReflections[i] = astroCollide((int)i, glm::vec2(agents.x[i], agents.z[i]), agents.heading[i]);
+		}
+	});
+
+	// bounce off other astros, stepping again along the new heading, then off
+	// the lobby; one already heading away from the wall it touches keeps going
+	// instead of turning back into it. Each astro only moves itself here.
+	lobbyContacts.resize(count);
+	JobSystem::parallelFor(count, agentGrain, [](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			if (astroReflections[i] != 10.0f) {
+				agents.setHeading(i, astroReflections[i]);
+				agents.step(i);
+			}
+		}
+
+		lobbyColliders.collide(&agents.x[begin], &agents.z[begin], end - begin, astroRadius, &lobbyContacts[begin]);
+		for (size_t i = begin; i < end; ++i) {
+			const Contact& contact = lobbyContacts[i];
+			glm::vec2 direction(glm::sin(agents.heading[i]), glm::cos(agents.heading[i]));
+			if (contact.hit && glm::dot(direction, contact.normal) < 0) {
+				agents.setHeading(i, reflectHeading(agents.heading[i], contact.normal));
+				agents.step(i);
+			}
 		}
+	});
+}
 
-		float lobbyReflectAngle = lobbyCollide(computerAstroMoveList[i]->getLocation(), angleList[i]);
-		if (lobbyReflectAngle != 10.0) {
-			angleList[i] = lobbyReflectAngle;
-                  computerAstroMoveList[i]->move(angleList[i]);
-                  computerAstroFaceList[i]->face(angleList[i]);
+void Window::syncAgentNodes() {
+	PROFILE_SCOPE("syncAgentNodes");
+	// write the results back into the scene graph once, every agent owns its nodes
+	JobSystem::parallelFor(agents.size(), agentGrain, [](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			agents.moveNode[i]->setLocation(glm::vec3(agents.x[i], astroHeight, agents.z[i]));
+			agents.faceNode[i]->face(agents.heading[i]);
 		}
-	}
+	});
 }
 
 void Window::mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
@@ -377,8 +637,8 @@ void Window::mouseButtonCallback(GLFWwindow* window, int button, int action, int
 }
 
 void Window::cursorPosCallback(GLFWwindow* window, double xpos, double ypos) {
-	// when flag pressed is true
-	if (keyPressed.mousePressed) {
+	// when flag pressed is true, a replay drives the camera itself
+	if (keyPressed.mousePressed && !InputRecorder::isReplaying()) {
 		// get current screen position and calculate current position in 3D
 		glm::vec2 currPos(xpos, ypos);
 		glm::vec3 currPoint = trackBallMapping(currPos);
@@ -398,15 +658,20 @@ void Window::cursorPosCallback(GLFWwindow* window, double xpos, double ypos) {
 				rotAxis.x = rotAxis.x > 0 ? 1 : -1;
 			}
 
-			glm::mat4 rotateMotion = glm::rotate(glm::mat4(1.0f), glm::radians(vertVelocity * 25.0f), rotAxis);
-			upVector = glm::vec3(rotateMotion * glm::vec4(upVector, 0.0));
-                  eyePos = glm::vec3(rotateMotion * glm::vec4(eyePos, 1.0));
-                  view = glm::lookAt(Window::eyePos, Window::lookAtPoint, Window::upVector);
+			// the camera belongs to the simulation thread, it turns at the next tick
+			Simulation::post(InputEvent{ 0, InputEvent::Camera, 0, (int8_t)rotAxis.x, 0, vertVelocity * 25.0f });
 			prevPoint = currPoint;
 		}
 	}
 }
 
+void Window::rotateCamera(float degrees, float axisX) {
+	glm::mat4 rotateMotion = glm::rotate(glm::mat4(1.0f), glm::radians(degrees), glm::vec3(axisX, 0, 0));
+	upVector = glm::vec3(rotateMotion * glm::vec4(upVector, 0.0));
+	eyePos = glm::vec3(rotateMotion * glm::vec4(eyePos, 1.0));
+	view = glm::lookAt(Window::eyePos, Window::lookAtPoint, Window::upVector);
+}
+
 glm::vec3 Window::trackBallMapping(glm::vec2 point) {
 	glm::vec3 v(0);
 	double d;
@@ -420,90 +685,33 @@ glm::vec3 Window::trackBallMapping(glm::vec2 point) {
 	return v;
 }
 
+float Window::reflectHeading(float angle, glm::vec2 normal) {
+	auto I = glm::vec2(glm::sin(angle), glm::cos(angle));
+	auto reflect = glm::reflect(I, normal);
+	return glm::atan(reflect.x, reflect.y);
+}
+
 float Window::lobbyCollide(glm::vec3 location, float angle) {
-	// collide left side
-	if (abs(location.x + 16) <= 1.1) {
-		std::cerr << "Collide l side!" << std::endl;
-		auto I = glm::vec2(glm::sin(angle), glm::cos(angle));
-		auto N = glm::vec2(1, 0);
-		auto reflect = glm::reflect(I, N);
-		return glm::atan(reflect.x, reflect.y);
-	}
-
-	// collide right side
-	if (abs(location.x - 17) <= 1.1) {
-		std::cerr << "Collide r side" << std::endl;
-		auto I = glm::vec2(glm::sin(angle), glm::cos(angle));
-		auto N = glm::vec2(-1, 0);
-		auto reflect = glm::reflect(I, N);
-		return glm::atan(reflect.x, reflect.y);
-	}
-
-	// collide up side
-	if (abs(location.z - 0) <= 1.1) {
-		std::cerr << "Collide u side!" << std::endl;
-		auto I = glm::vec2(glm::sin(angle), glm::cos(angle));
-		auto N = glm::vec2(0, 1);
-		auto reflect = glm::reflect(I, N);
-		return glm::atan(reflect.x, reflect.y);
-	}
-
-	// collide down side
-	if (abs(location.z - 17) <= 1.1) {
-		std::cerr << "Collide d side!" << std::endl;
-		auto I = glm::vec2(glm::sin(angle), glm::cos(angle));
-		auto N = glm::vec2(0, -1);
-		auto reflect = glm::reflect(I, N);
-		return glm::atan(reflect.x, reflect.y);
-	}
-
-	// collide box 1
-	if (glm::length(glm::vec2(location.x, location.z) - glm::vec2(-9, 7)) <= 1.1 + 2.5) {
-		std::cerr << "Collide box 1!" << std::endl;
-		auto I = glm::vec2(glm::sin(angle), glm::cos(angle));
-		auto N = glm::normalize(glm::vec2(location.x, location.z) - glm::vec2(-9, 7));
-		auto reflect = glm::reflect(I, N);
-		return glm::atan(reflect.x, reflect.y);
-	}
-
-	// collide box 2
-	if (glm::length(glm::vec2(location.x, location.z) - glm::vec2(11, 4)) <= 1.1 + 2.5) {
-		std::cerr << "Collide box 2!" << std::endl;
-		auto I = glm::vec2(glm::sin(angle), glm::cos(angle));
-		auto N = glm::normalize(glm::vec2(location.x, location.z) - glm::vec2(11, 4));
-		auto reflect = glm::reflect(I, N);
-		return glm::atan(reflect.x, reflect.y);
-	}
-
-	// collide lower left diagonal line
-	if (abs(4 * location.x + (-5) * location.z + 128) / glm::sqrt(4 * 4 + 5 * 5) <= 1.1) {
-		std::cerr << "Collide diag 1!" << std::endl;
-		auto I = glm::vec2(glm::sin(angle), glm::cos(angle));
-		auto N = glm::normalize(glm::vec2(4, -5));
-		auto reflect = glm::reflect(I, N);
-		return glm::atan(reflect.x, reflect.y);
-	}
-
-	// collide lower right diagonal line
-	if (abs(4 * location.x + 5 * location.z - 130) / glm::sqrt(4 * 4 + 5 * 5) <= 1.1) {
-		std::cerr << "Collide diag 2!" << std::endl;
-		auto I = glm::vec2(glm::sin(angle), glm::cos(angle));
-		auto N = glm::normalize(glm::vec2(-4, -5));
-		auto reflect = glm::reflect(I, N);
-		return glm::atan(reflect.x, reflect.y);
+	Contact contact = lobbyColliders.collide(xz(location), astroRadius);
+	if (contact.hit) {
+		return reflectHeading(angle, contact.normal);
 	}
 
 	// no collision flag
 	return 10.0;
 }
 
-float Window::astroCollide(glm::vec3 location, float angle) {
-	if (location.x != playerAstroMoveControl->getLocation().x ||
-		location.y != playerAstroMoveControl->getLocation().y ||
-		location.z != playerAstroMoveControl->getLocation().z) {
-		auto centerVec = glm::vec2(location.x, location.z) -
-			glm::vec2(playerAstroMoveControl->getLocation().x, playerAstroMoveControl->getLocation().z);
-		if (glm::length(centerVec) <= 2) {
+void Window::buildAstroGrid() {
+	PROFILE_SCOPE("buildAstroGrid");
+	playerPosition = xz(playerAstroMoveControl->getLocation());
+	astroGrid.build(agents.x.data(), agents.z.data(), agents.size());
+}
+
+float Window::astroCollide(int self, glm::vec2 location, float angle) {
+	// the player isn't in the grid, test it on its own
+	if (self != -1) {
+		auto centerVec = location - playerPosition;
+		if (glm::length(centerVec) <= 2 && glm::length(centerVec) > 0) {
                   auto I = glm::vec2(glm::sin(angle), glm::cos(angle));
 			auto N = glm::normalize(centerVec);
                   auto reflect = glm::reflect(I, N);
@@ -511,119 +719,124 @@ float Window::astroCollide(glm::vec3 location, float angle) {
 		}
 	}
 
-	for (auto computerAstro : computerAstroMoveList) {
-            if (location.x != computerAstro->getLocation().x ||
-                  location.y != computerAstro->getLocation().y ||
-                  location.z != computerAstro->getLocation().z) {
-
-                  auto centerVec = glm::vec2(location.x, location.z) -
-                        glm::vec2(computerAstro->getLocation().x, computerAstro->getLocation().z);
-                  if (glm::length(centerVec) <= 2) {
-                        auto I = glm::vec2(glm::sin(angle), glm::cos(angle));
-                        auto N = glm::normalize(centerVec);
-                        auto reflect = glm::reflect(I, N);
-                        return glm::atan(reflect.x, reflect.y);
-                  }
-            }
-	}
-
-	return 10.0;
-}
-
-bool Window::initialAstroCollide(glm::vec3 location) {
-		auto centerVec = glm::vec2(location.x, location.z) -
-			glm::vec2(playerAstroMoveControl->getLocation().x, playerAstroMoveControl->getLocation().z);
-		if (glm::length(centerVec) <= 2) {
+	// only computer astros in neighbouring cells can touch this one
+	float reflectAngle = 10.0;
+	astroGrid.query(location, [&](uint32_t other) {
+		if ((int)other == self) {
 			return true;
 		}
+		auto centerVec = location - glm::vec2(agents.x[other], agents.z[other]);
+		if (glm::length(centerVec) <= 2 && glm::length(centerVec) > 0) {
+			auto I = glm::vec2(glm::sin(angle), glm::cos(angle));
+			auto N = glm::normalize(centerVec);
+			auto reflect = glm::reflect(I, N);
+			reflectAngle = glm::atan(reflect.x, reflect.y);
+			return false;
+		}
+		return true;
+	});
 
-	for (auto computerAstro : computerAstroMoveList) {
-            auto centerVec = glm::vec2(location.x, location.z) -
-                  glm::vec2(computerAstro->getLocation().x, computerAstro->getLocation().z);
-            if (glm::length(centerVec) <= 2) {
-			return true;
-            }
+	return reflectAngle;
+}
+
+bool Window::initialAstroCollide(glm::vec2 location) {
+	if (glm::length(location - playerPosition) <= 2) {
+		return true;
 	}
 
-	return false;
+	bool collide = false;
+	astroGrid.query(location, [&](uint32_t other) {
+		collide = glm::length(location - glm::vec2(agents.x[other], agents.z[other])) <= 2;
+		return !collide;
+	});
+
+	return collide;
 }
 
-void Window::randomAdd() {
-	if (computerAstroMoveList.size() == 10) {
-		return;
+bool Window::randomAdd(bool force) {
+	if (agents.size() >= maxComputerAstros) {
+		return false;
 	}
 
-	float randomX = (float) rand() / RAND_MAX * 30 - 15;
-	float fixY = -4.3;
-	float randomZ = (float) rand() / RAND_MAX * 10;
-	auto randomLoc = glm::vec3(randomX, fixY, randomZ);
-	std::cerr << randomX << ", " << randomZ << std::endl;
-
-	while (lobbyCollide(randomLoc, 0) != 10.0 || initialAstroCollide(randomLoc)) {
-            randomX = (float) rand() / RAND_MAX * 30 - 15;
-		randomZ = (float) rand() / RAND_MAX * 10;
-		randomLoc = glm::vec3(randomX, fixY, randomZ);
+	// look for a free spot, a crowded lobby may not have one
+	glm::vec3 randomLoc;
+	bool inLobby = false;
+	bool found = false;
+	for (int attempt = 0; attempt < spawnAttempts && !found; ++attempt) {
+		float randomX = spawnRng.uniform() * 30 - 15;
+		float randomZ = spawnRng.uniform() * 10;
+		auto location = glm::vec3(randomX, astroHeight, randomZ);
+		if (lobbyCollide(location, 0) != 10.0) {
+			continue;
+		}
+		randomLoc = location;
+		inLobby = true;
+		found = !initialAstroCollide(xz(location));
 	}
+	if (!found && !(force && inLobby)) {
+		return false;
+	}
+	LOG_DEBUG("Spawned an astro at %g, %g", randomLoc.x, randomLoc.z);
 
 	// particle effect appear
       auto lobby2ComputerAstro = new Transform(glm::translate(randomLoc));
       auto computerAstroFace = new Transform(glm::mat4(1));
 
-	int randomColorIndex = rand() % 12;
-	while (colorStatus[randomColorIndex]) {
-		randomColorIndex = rand() % 12;
+	// prefer a color nobody wears, share one once all are taken
+	int randomColorIndex = spawnRng.below(12);
+	if (std::find(colorStatus.begin(), colorStatus.end(), false) != colorStatus.end()) {
+		while (colorStatus[randomColorIndex]) {
+			randomColorIndex = spawnRng.below(12);
+		}
 	}
-      auto computerAstro = new Geometry("models/amongus_astro_still.obj", toonShader, glm::vec3(0.1), colorList[randomColorIndex], glm::vec3(0), glm::vec3(1));
 	colorStatus[randomColorIndex] = true;
 
-	auto particle = new Particle(particleShader, glm::vec3(0, 1, 1), 150, 2);
+	auto particle = new Particle(spawnEffect);
 
       lobby->addChild(lobby2ComputerAstro);
       lobby2ComputerAstro->addChild(computerAstroFace);
 	lobby2ComputerAstro->addChild(particle);
-      computerAstroFace->addChild(computerAstro);
-
-      computerAstroMoveList.push_back(lobby2ComputerAstro);
-      computerAstroFaceList.push_back(computerAstroFace);
-	particleList.push_back(particle);
+	// until its mesh is resident only the spawn effect shows
+	if (!headless) {
+		auto computerAstro = new Geometry("models/amongus_astro_still.obj", toonShader, glm::vec3(0.1), colorList[randomColorIndex], glm::vec3(0), glm::vec3(1), true);
+		computerAstroFace->addChild(computerAstro);
+	}
 
-	float randomAngle = glm::radians((float) rand() / RAND_MAX * 360.0);
-	angleList.push_back(randomAngle);
-	colorIndexList.push_back(randomColorIndex);
+	float randomAngle = glm::radians(spawnRng.uniform() * 360.0f);
+	computerAstroFace->face(randomAngle);
+	agents.add(randomLoc.x, randomLoc.z, randomAngle, randomColorIndex, lobby2ComputerAstro, computerAstroFace, particle);
+	return true;
 }
 
 void Window::randomRemove() {
-	if (computerAstroMoveList.size() == 0) {
+	if (agents.size() == 0) {
 		return;
 	}
 
 	// particle effect disappear
 	if (removeDelay == 200) {
-            indexToRemove = rand() % computerAstroMoveList.size();
-		particleList[indexToRemove]->resetCounter();
+            indexToRemove = removeRng.below((uint32_t)agents.size());
+		agents.particle[indexToRemove]->emit(despawnEffect);
 	}
 	if (removeDelay > 0) {
 		--removeDelay;
 	}
 	else {
-            lobby->removeChild(computerAstroMoveList[indexToRemove]);
-            computerAstroMoveList.erase(computerAstroMoveList.begin() + indexToRemove);
-            computerAstroFaceList.erase(computerAstroFaceList.begin() + indexToRemove);
-            particleList.erase(particleList.begin() + indexToRemove);
-            angleList.erase(angleList.begin() + indexToRemove);
-
-            colorStatus[colorIndexList[indexToRemove]] = false;
-            colorIndexList.erase(colorIndexList.begin() + indexToRemove);
+            // the renderer may still draw it from an older snapshot
+            lobby->detachChild(agents.moveNode[indexToRemove]);
+            scene.retire(agents.moveNode[indexToRemove]);
+            colorStatus[agents.color[indexToRemove]] = false;
+            agents.remove(indexToRemove);
 		removeDelay = 200;
 		indexToRemove = -1;
 	}
 }
 
 void Window::randomToggle() {
-	if (computerAstroMoveList.size() == 0) {
+	if (agents.size() == 0) {
 		return;
 	}
 
-      int index = rand() % computerAstroMoveList.size();
-	computerAstroMoveList[index]->toggleMove();
+      int index = wanderRng.below((uint32_t)agents.size());
+	agents.speed[index] = agents.speed[index] == 0.0f ? 0.1f : 0.0f;
 }
@@ -5,10 +5,32 @@
 #include <time.h>
 
 #include "main.h"
-#include "shader.h"
+#include "ShaderProgram.h"
+#include "FrameUniforms.h"
+#include "Scene.h"
 #include "Transform.h"
 #include "Geometry.h"
+#include "MeshCache.h"
+#include "AssetLoader.h"
+#include "JobSystem.h"
+#include "InstancedRenderer.h"
+#include "RenderQueue.h"
 #include "Particle.h"
+#include "SpatialHash.h"
+#include "CollisionWorld.h"
+#include "AgentStore.h"
+#include "Profiler.h"
+#include "Log.h"
+#include "Rng.h"
+#include "InputRecorder.h"
+
+// seconds spent in each phase of idleCallback, accumulated until reset
+struct TickTimings {
+	double movement;
+	double collision;
+	double spawn;
+	double scene;
+};
 
 struct KeyRecord {
 	bool wPressed;
@@ -28,14 +50,43 @@ public:
 
 	// Root of scene graph, world
 	static Transform* world;
-	static Geometry* lobby;
+	// flattened copy of the graph under world, what is updated and drawn
+	static Scene scene;
+	// parent of every astro
+	static Transform* lobby;
 	static Transform* playerAstroMoveControl;
 	static Transform* playerAstroFaceControl;
-	static std::vector<Transform*> computerAstroMoveList;
-	static std::vector<Transform*> computerAstroFaceList;
-	static std::vector<Particle*> particleList;
-	static std::vector<float> angleList;
-	static std::vector<int> colorIndexList;
+	// computer astros, simulated as structure of arrays
+	static AgentStore agents;
+	// most computer astros alive at once
+	static size_t maxComputerAstros;
+	// height of every astro above the lobby origin
+	static const float astroHeight;
+	// points in each astro's particle effect
+	static int particleCount;
+	// particle effects that can play at the same time
+	static int particleSlots;
+	// threads reading and building model files, at least one with a window
+	// so no mesh is uploaded on the simulation thread
+	static unsigned loaderThreads;
+	// threads updating the simulation and scene, the main one included, 0 for one per core
+	static unsigned jobThreads;
+	// agents per chunk of a parallel loop
+	static const size_t agentGrain;
+	// particle effects when an astro appears and disappears
+	static EmitterSettings spawnEffect;
+	static EmitterSettings despawnEffect;
+
+	// simulate without a GL context: no geometry is created and nothing is drawn
+	static bool headless;
+	// seed of every RNG below, the current time unless given on the command line
+	static unsigned seed;
+	// where astros appear, what they look like and when
+	static Rng spawnRng;
+	// which astro leaves and when
+	static Rng removeRng;
+	// astros stopping and starting to walk
+	static Rng wanderRng;
 
 	// Key Transform node that control animation
 	// Camera Matrices
@@ -55,10 +106,11 @@ public:
 	static int removeDelay;
 	static int indexToRemove;
 
-	// Shader Program ID
-	static GLuint phongShader;
-	static GLuint toonShader;
-	static GLuint particleShader;
+	// Shader Programs
+	static ShaderProgram* phongShader;
+	static ShaderProgram* toonShader;
+	static ShaderProgram* particleShader;
+	static ShaderProgram* particleUpdateShader;
 
 	// Constructors and Destructors
 	static bool initializeProgram();
@@ -70,28 +122,66 @@ public:
 	static void resizeCallback(GLFWwindow* window, int width, int height);
 
 	// Draw and Update functions
+	// fixed simulation step in seconds, idleCallback runs once per step
+	static const double tickLength;
 	static void idleCallback();
-	static void displayCallback(GLFWwindow*);
+	static TickTimings tickTimings;
+	// copy what is drawn out of the scene after a tick, on the simulation thread
+	static void captureSnapshot(RenderSnapshot& snapshot);
+	// draw a snapshot, alpha is how far the current time is from its tick to the next
+	static void displayCallback(GLFWwindow*, const RenderSnapshot& snapshot, float alpha);
 
 	// Callbacks
+	// keys and mouse as the callbacks saw them, main thread only
 	static KeyRecord keyPressed;
+	// movement keys the simulation acts on, set from the input queue
+	static KeyRecord playerKeys;
 	static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+	// W, A, S and D held down, as bits 0-3
+	static uint8_t movementKeys();
+	// apply a recorded input change while replaying
+	static void applyInput(const InputEvent& event);
+	// apply and record input queued by the callbacks, ignored while replaying
+	static void applyLiveInput(const InputEvent& event);
 	static void playerMovement();
 	static void computerMovement();
+	static void computerCollision();
+	// copy agent positions and headings into their scene graph nodes
+	static void syncAgentNodes();
 
 	static glm::vec2 pressedPos;
 	static glm::vec3 prevPoint;
 	static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 	static void cursorPosCallback(GLFWwindow* window, double xpos, double ypos);
+	// orbit the camera around the x axis, axisX is 1 or -1
+	static void rotateCamera(float degrees, float axisX);
 	static glm::vec3 trackBallMapping(glm::vec2 point);
 
 	// collision detection
+	// player xz position, cached once per tick
+	static glm::vec2 playerPosition;
+	// broad phase over the agent positions, rebuilt at the start of every tick
+	static SpatialHash astroGrid;
+	static void buildAstroGrid();
+	// walls and props of the lobby, read from a collider file at start up
+	static CollisionWorld lobbyColliders;
+	// lobby contact of every computer astro, queried together once per tick
+	static std::vector<Contact> lobbyContacts;
+	// heading of every computer astro after bouncing off the others, 10 if it didn't touch one
+	static std::vector<float> astroReflections;
+	// how close an astro's center gets to a wall or prop
+	static const float astroRadius;
+	// heading after bouncing off a surface with this normal
+	static float reflectHeading(float angle, glm::vec2 normal);
 	static float lobbyCollide(glm::vec3 location, float angle);
-	static float astroCollide(glm::vec3 location, float angle);
-	static bool initialAstroCollide(glm::vec3 location);
-
-	// randomly add astro
-	static void randomAdd();
+	// self is the index of the moving computer astro, -1 for the player
+	static float astroCollide(int self, glm::vec2 location, float angle);
+	static bool initialAstroCollide(glm::vec2 location);
+
+	// spots tried before giving up on spawning an astro
+	static const int spawnAttempts;
+	// randomly add astro, force places it even if it overlaps another astro
+	static bool randomAdd(bool force = false);
 	// randomly remove astro
 	static void randomRemove();
 
@@ -1,4 +1,6 @@
 #include "main.h"
+#include "Benchmark.h"
+#include "Simulation.h"
 
 void error_callback(int error, const char* description)
 {
@@ -55,8 +57,31 @@ void print_versions()
 
 
 
-int main(void)
+int main(int argc, char* argv[])
 {
+	Profiler::setThreadName("main");
+
+	BenchmarkConfig config;
+	if (!Benchmark::parseArgs(argc, argv, config))
+		exit(EXIT_FAILURE);
+
+	// Messages are written by a background thread from here on.
+	if (!Log::start(config.log))
+		exit(EXIT_FAILURE);
+
+	// Record the input, or take it and the settings from a recording.
+	if (!Benchmark::startSession(config))
+		exit(EXIT_FAILURE);
+
+	// Simulate without opening a window.
+	if (config.headless)
+	{
+		int result = Benchmark::run(config);
+		Log::stop();
+		exit(result);
+	}
+	Benchmark::apply(config);
+
 	// Create the GLFW window.
 	GLFWwindow* window = Window::createWindow(640, 480);
 	if (!window) 
@@ -79,15 +104,33 @@ int main(void)
 	if (!Window::initializeObjects()) 
 		exit(EXIT_FAILURE);
 	
-	// Loop while GLFW window should stay open.
-	while (!glfwWindowShouldClose(window))
+	// Simulate in fixed steps on a thread of its own, render as often as possible meanwhile.
+	double startTime = glfwGetTime();
+	unsigned frames = 0;
+	Simulation::start();
+
+	// Loop while GLFW window should stay open, or until a replay is over.
+	while (!glfwWindowShouldClose(window) && !Simulation::isFinished())
 	{
-		// Main render display callback. Rendering of objects is done here. (Draw)
-		Window::displayCallback(window);
+		// Main render display callback, draws the newest tick the simulation published. (Draw)
+		const RenderSnapshot& snapshot = Simulation::acquire();
+		Window::displayCallback(window, snapshot, Simulation::blendFactor(snapshot));
+		++frames;
+
+		// Collect timings of the frame when profiling.
+		Profiler::endFrame();
+	}
+
+	Simulation::stop();
 
-		// Idle callback. Updating objects, etc. can be done here. (Update)
-		Window::idleCallback();
+	// Frame rate over the whole replay, the number to compare between builds.
+	if (InputRecorder::isReplaying())
+	{
+		double seconds = glfwGetTime() - startTime;
+		std::cout << "Replayed " << InputRecorder::replayHeader().ticks << " ticks in " << seconds << " s, "
+			<< frames << " frames (" << seconds * 1000.0 / (frames > 0 ? frames : 1) << " ms/frame)" << std::endl;
 	}
+	InputRecorder::stopRecording(Transform::tick);
 
 	// destroy objects created
 	Window::cleanUp();
@@ -98,5 +141,8 @@ int main(void)
 	// Terminate GLFW.
 	glfwTerminate();
 
+	// Write what is still queued.
+	Log::stop();
+
 	exit(EXIT_SUCCESS);
 }
\ No newline at end of file
@@ -1,107 +1,100 @@
 #include "shader.h"
+#include <sstream>
 
-enum ShaderType { vertex, fragment };
-
-GLuint LoadSingleShader(const char * shaderFilePath, ShaderType type) 
+bool ReadShaderFile(const char * shaderFilePath, std::string& source)
 {
-	// Create a shader id.
-	GLuint shaderID = 0;
-	if (type == vertex) 
-		shaderID = glCreateShader(GL_VERTEX_SHADER);
-	else if (type == fragment) 
-		shaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
-	// Try to read shader codes from the shader file.
-	std::string shaderCode;
-	std::ifstream shaderStream(shaderFilePath, std::ios::in);
-	if (shaderStream.is_open()) 
-	{
-		std::string Line = "";
-		while (getline(shaderStream, Line))
-			shaderCode += "\n" + Line;
-		shaderStream.close();
-	}
-	else 
+	// Read the whole file in one go.
+	std::ifstream shaderStream(shaderFilePath, std::ios::in | std::ios::binary);
+	if (!shaderStream.is_open())
 	{
 		std::cerr << "Impossible to open " << shaderFilePath << ". "
 			<< "Check to make sure the file exists and you passed in the "
 			<< "right filepath!"
 			<< std::endl;
-		return 0;
+		return false;
 	}
+	std::ostringstream contents;
+	contents << shaderStream.rdbuf();
+	source = contents.str();
+	return true;
+}
 
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
-
-	// Compile Shader.
-	std::cerr << "Compiling shader: " << shaderFilePath << std::endl;
-	char const * sourcePointer = shaderCode.c_str();
+// Create a shader and start compiling it, the status is checked after linking.
+static GLuint CompileShader(const std::string& source, GLenum type)
+{
+	GLuint shaderID = glCreateShader(type);
+	char const * sourcePointer = source.c_str();
 	glShaderSource(shaderID, 1, &sourcePointer, NULL);
 	glCompileShader(shaderID);
-	
-	// Check Shader.
-	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if (InfoLogLength > 0) 
-	{
-		std::vector<char> shaderErrorMessage(InfoLogLength + 1);
-		glGetShaderInfoLog(shaderID, InfoLogLength, NULL, shaderErrorMessage.data());
-		std::string msg(shaderErrorMessage.begin(), shaderErrorMessage.end());
-		std::cerr << msg << std::endl;
-		return 0;
-	}
-	else 
-	{
-		if (type == vertex)
-			printf("Successfully compiled vertex shader!\n");
-		else if (type == fragment) 
-			printf("Successfully compiled fragment shader!\n");
-	}
-
 	return shaderID;
 }
 
-GLuint LoadShaders(const char * vertexFilePath, const char * fragmentFilePath) 
+// Print the log of a shader or program, if there is one.
+static void PrintLog(GLuint id, bool program)
 {
-	// Create the vertex shader and fragment shader.
-	GLuint vertexShaderID = LoadSingleShader(vertexFilePath, vertex);
-	GLuint fragmentShaderID = LoadSingleShader(fragmentFilePath, fragment);
-
-	// Check both shaders.
-	if (vertexShaderID == 0 || fragmentShaderID == 0) return 0;
+	int InfoLogLength = 0;
+	if (program)
+		glGetProgramiv(id, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	else
+		glGetShaderiv(id, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if (InfoLogLength <= 0)
+		return;
 
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
+	std::vector<char> message(InfoLogLength + 1);
+	if (program)
+		glGetProgramInfoLog(id, InfoLogLength, NULL, message.data());
+	else
+		glGetShaderInfoLog(id, InfoLogLength, NULL, message.data());
+	std::cerr << message.data() << std::endl;
+}
 
-	// Link the program.
-	printf("Linking program\n");
+GLuint BeginProgram(const std::string& vertexSource, const std::string& fragmentSource, const std::vector<const char *>& varyings, bool retrievable)
+{
 	GLuint programID = glCreateProgram();
+	GLuint vertexShaderID = CompileShader(vertexSource, GL_VERTEX_SHADER);
 	glAttachShader(programID, vertexShaderID);
-	glAttachShader(programID, fragmentShaderID);
+	if (!fragmentSource.empty())
+	{
+		GLuint fragmentShaderID = CompileShader(fragmentSource, GL_FRAGMENT_SHADER);
+		glAttachShader(programID, fragmentShaderID);
+	}
+
+	// The captured outputs have to be declared before linking.
+	if (!varyings.empty())
+		glTransformFeedbackVaryings(programID, (GLsizei)varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+	if (retrievable)
+		glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	// The shaders stay attached until FinishProgram so their logs can be read.
 	glLinkProgram(programID);
+	return programID;
+}
 
-	// Check the program.
+GLuint FinishProgram(GLuint programID)
+{
+	// Check the program, this waits for the driver.
+	GLint Result = GL_FALSE;
 	glGetProgramiv(programID, GL_LINK_STATUS, &Result);
-	glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if (InfoLogLength > 0) 
+
+	// Detach and delete the shaders, printing why they failed to compile.
+	GLuint shaders[2];
+	GLsizei shaderCount = 0;
+	glGetAttachedShaders(programID, 2, &shaderCount, shaders);
+	for (GLsizei i = 0; i < shaderCount; ++i)
 	{
-		std::vector<char> ProgramErrorMessage(InfoLogLength + 1);
-		glGetProgramInfoLog(programID, InfoLogLength, NULL, ProgramErrorMessage.data());
-		std::string msg(ProgramErrorMessage.begin(), ProgramErrorMessage.end());
-		std::cerr << msg << std::endl;
-		glDeleteProgram(programID);
-		return 0;
+		GLint compiled = GL_FALSE;
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compiled);
+		if (!compiled)
+			PrintLog(shaders[i], false);
+		glDetachShader(programID, shaders[i]);
+		glDeleteShader(shaders[i]);
 	}
-	else
+
+	if (!Result)
 	{
-		printf("Successfully linked program!\n");
+		PrintLog(programID, true);
+		glDeleteProgram(programID);
+		return 0;
 	}
-
-	// Detach and delete the shaders as they are no longer needed.
-	glDetachShader(programID, vertexShaderID);
-	glDetachShader(programID, fragmentShaderID);
-	glDeleteShader(vertexShaderID);
-	glDeleteShader(fragmentShaderID);
-
 	return programID;
 }
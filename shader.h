@@ -14,6 +14,13 @@
 #include <fstream>
 #include <algorithm>
 
-GLuint LoadShaders(const char * vertex_file_path, const char * fragment_file_path);
+// read a whole shader file, false when it can't be opened
+bool ReadShaderFile(const char * shaderFilePath, std::string& source);
+// create a program and issue the compiles and the link without waiting for
+// any of them; fragmentSource may be empty, varyings are captured with
+// transform feedback
+GLuint BeginProgram(const std::string& vertexSource, const std::string& fragmentSource, const std::vector<const char *>& varyings, bool retrievable);
+// wait for a program from BeginProgram and print its logs, 0 on failure
+GLuint FinishProgram(GLuint programID);
 
 #endif
@@ -3,15 +3,14 @@
 
 // Inputs to the fragment shader are the outputs of the same name from the vertex shader.
 // Note that you do not have access to the vertex shader's default output, gl_Position.
-in float sampleExtraOutput;
-
-uniform vec3 color;
+in float alpha;
+in vec3 particleColor;
 
 // You can output many things. The first vec4 type output determines the color of the fragment
 out vec4 fragColor;
 
 void main()
 {
-    // Use the color passed in. An alpha of 1.0f means it is not transparent.
-    fragColor = vec4(color, sampleExtraOutput);
+    // Dim the color as the particle ages.
+    fragColor = vec4(particleColor * (0.25 + 0.75 * alpha), 1.0);
 }
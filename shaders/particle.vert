@@ -1,27 +1,56 @@
 #version 330 core
 // NOTE: Do NOT use any version older than 330! Bad things will happen!
 
-// This is an example vertex shader. GLSL is very similar to C.
-// You can define extra functions if needed, and the main() function is
-// called when the vertex shader gets run.
-// The vertex shader gets called once per vertex.
+// Draws the particles advanced by particle_update.vert, straight from the
+// transform feedback buffer. Emitter transform, color and point size come
+// from the slot the particle belongs to.
 
 layout (location = 0) in vec3 position;
+// x is the age, y the lifetime in seconds
+layout (location = 2) in vec2 life;
+
+// Camera and light data shared by every program, see FrameUniforms
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 eyePos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
+// one entry per pool slot, see ParticlePool::EmitterData
+struct Emitter {
+    mat4 transform;
+    vec4 color;     // rgb, point size
+    vec4 spawn;     // radius, height, speed jitter, swirl
+    vec4 velocity;  // initial velocity, gravity
+    vec4 timing;    // lifetime, restart, emitting, in use
+};
+
+layout (std140) uniform EmitterBlock {
+    Emitter emitters[128];
+};
 
 // Uniform variables can be updated by fetching their location and passing values to that location
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 transform;
-uniform mat4 model;
+uniform int particlesPerSlot;
 
-// Outputs of the vertex shader are the inputs of the same name of the fragment shader.
-// The default output, gl_Position, should be assigned something. You can define as many
-// extra outputs as you need.
-out vec3 worldPos;
+// how much of its life a particle has left, fades the color out
+out float alpha;
+out vec3 particleColor;
 
 void main()
 {
-    // OpenGL maintains the D matrix so you only need to multiply by P, V (aka C inverse), and M
-    gl_Position = projection * view * transform * model * vec4(position, 1.0);
-    worldPos = vec3(transform * model * vec4(position, 1.0));
+    Emitter e = emitters[gl_VertexID / particlesPerSlot];
+    particleColor = e.color.rgb;
+    gl_PointSize = e.color.w;
+
+    if (life.x < 0.0 || life.x >= life.y) {
+        // unborn or dead, place it outside the clip volume
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        alpha = 0.0;
+        return;
+    }
+
+    gl_Position = projection * view * e.transform * vec4(position, 1.0);
+    alpha = 1.0 - life.x / life.y;
 }
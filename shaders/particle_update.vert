@@ -0,0 +1,98 @@
+#version 330 core
+// Advances every particle of the pool by one step. Runs with rasterizer
+// discard, the outputs are captured with transform feedback into the other
+// buffer of the ping-pong pair.
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 velocity;
+// x is the age, y the lifetime in seconds; a particle is alive while 0 <= age < lifetime
+layout (location = 2) in vec2 life;
+
+out vec3 outPosition;
+out vec3 outVelocity;
+out vec2 outLife;
+
+// one entry per pool slot, see ParticlePool::EmitterData
+struct Emitter {
+    mat4 transform;
+    vec4 color;     // rgb, point size
+    vec4 spawn;     // radius, height, speed jitter, swirl
+    vec4 velocity;  // initial velocity, gravity
+    vec4 timing;    // lifetime, restart, emitting, in use
+};
+
+layout (std140) uniform EmitterBlock {
+    Emitter emitters[128];
+};
+
+uniform float deltaTime;
+uniform uint seed;
+// slot i owns particles [i * particlesPerSlot, (i + 1) * particlesPerSlot)
+uniform int particlesPerSlot;
+
+// integer hash to [0, 1)
+float random(uint n)
+{
+    n = (n ^ 61u) ^ (n >> 16u);
+    n *= 9u;
+    n = n ^ (n >> 4u);
+    n *= 0x27d4eb2du;
+    n = n ^ (n >> 15u);
+    return float(n & 0x00ffffffu) / 16777216.0;
+}
+
+void main()
+{
+    vec3 p = position;
+    vec3 v = velocity;
+    vec2 l = life;
+    uint id = uint(gl_VertexID);
+    Emitter e = emitters[gl_VertexID / particlesPerSlot];
+    float radius = e.spawn.x;
+    float height = e.spawn.y;
+    float speedJitter = e.spawn.z;
+    float swirl = e.spawn.w;
+    float gravity = e.velocity.w;
+    float lifetime = e.timing.x;
+
+    if (e.timing.w == 0.0) {
+        // free slot, nothing alive
+        l = vec2(0.0);
+    }
+    else if (e.timing.y != 0.0) {
+        // (re)started, births are spread evenly over the first lifetime
+        p = vec3(0.0);
+        v = vec3(0.0);
+        l = vec2(-lifetime * float(gl_VertexID % particlesPerSlot) / float(particlesPerSlot), 0.0);
+    }
+    else {
+        l.x += deltaTime;
+        if (l.x >= l.y) {
+            if (e.timing.z != 0.0) {
+                // born on a disc around the emitter, random height and speed
+                uint n = id * 8u + seed * 747796405u;
+                float angle = random(n) * 6.2831853;
+                float distance = sqrt(random(n + 1u)) * radius;
+                p = vec3(cos(angle) * distance, random(n + 2u) * height, sin(angle) * distance);
+                v = e.velocity.xyz * (1.0 + speedJitter * (random(n + 3u) * 2.0 - 1.0));
+                l = vec2(0.0, lifetime * (0.75 + 0.5 * random(n + 5u)));
+            }
+            else {
+                // stay dead, keep the age from growing without bound
+                l.x = l.y;
+            }
+        }
+        else if (l.x >= 0.0) {
+            // fall, move and turn around the emitter axis
+            v.y -= gravity * deltaTime;
+            p += v * deltaTime;
+            float s = sin(swirl * deltaTime);
+            float c = cos(swirl * deltaTime);
+            p.xz = vec2(c * p.x - s * p.z, s * p.x + c * p.z);
+        }
+    }
+
+    outPosition = p;
+    outVelocity = v;
+    outLife = l;
+}
@@ -6,9 +6,15 @@
 in vec3 worldPos;
 in vec3 worldNormal;
 
-uniform vec3 eyePos;
-uniform vec3 lightPos;
-uniform vec3 lightColor;
+// Camera and light data shared by every program, see FrameUniforms
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 eyePos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
+
 uniform vec3 kAmbient;
 uniform vec3 kDiffuse;
 uniform vec3 kSpecular;
@@ -7,11 +7,19 @@
 // The vertex shader gets called once per vertex.
 
 layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 normal;
+// octahedral encoded, see MeshBuilder::encodeNormal
+layout (location = 1) in vec2 normal;
+
+// Camera and light data shared by every program, see FrameUniforms
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 eyePos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
 
 // Uniform variables can be updated by fetching their location and passing values to that location
-uniform mat4 view;
-uniform mat4 projection;
 uniform mat4 transform;
 uniform mat4 model;
 
@@ -21,10 +29,19 @@ uniform mat4 model;
 out vec3 worldPos;
 out vec3 worldNormal;
 
+vec3 decodeNormal(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main()
 {
     // OpenGL maintains the D matrix so you only need to multiply by P, V (aka C inverse), and M
     gl_Position = projection * view * transform * model * vec4(position, 1.0);
     worldPos = vec3(transform * model * vec4(position, 1.0));
-    worldNormal = normalize(vec3(transpose(inverse(transform * model)) * vec4(normal, 0.0)));
+    worldNormal = normalize(vec3(transpose(inverse(transform * model)) * vec4(decodeNormal(normal), 0.0)));
 }
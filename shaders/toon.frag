@@ -6,12 +6,18 @@
 // Note that you do not have access to the vertex shader's default output, gl_Position.
 in vec3 worldPos;
 in vec3 worldNormal;
+in vec3 diffuseColor;
+
+// Camera and light data shared by every program, see FrameUniforms
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 eyePos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
 
-uniform vec3 eyePos;
-uniform vec3 lightPos;
-uniform vec3 lightColor;
 uniform vec3 kAmbient;
-uniform vec3 kDiffuse;
 uniform vec3 kSpecular;
 
 // You can output many things. The first vec4 type output determines the color of the fragment
@@ -32,7 +38,7 @@ void main()
     // calculate the factor in diffuse model
     float diffuseFactor = max(dot(lightVec, worldNormal), 0);
     // cdiffuse color
-    vec3 diffuse = attLightColor * kDiffuse * diffuseFactor;
+    vec3 diffuse = attLightColor * diffuseColor * diffuseFactor;
 
     // viewing direction
     vec3 eyeVec = normalize(eyePos - worldPos);
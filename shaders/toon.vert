@@ -7,24 +7,43 @@
 // The vertex shader gets called once per vertex.
 
 layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 normal;
+// octahedral encoded, see MeshBuilder::encodeNormal
+layout (location = 1) in vec2 normal;
+// Per instance attributes filled by InstancedRenderer. The mat4 takes locations 2 to 5.
+layout (location = 2) in mat4 instanceTransform;
+layout (location = 6) in vec3 instanceDiffuse;
 
-// Uniform variables can be updated by fetching their location and passing values to that location
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 transform;
-uniform mat4 model;
+// Camera and light data shared by every program, see FrameUniforms
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec3 eyePos;
+    vec3 lightPos;
+    vec3 lightColor;
+};
 
 // Outputs of the vertex shader are the inputs of the same name of the fragment shader.
 // The default output, gl_Position, should be assigned something. You can define as many
 // extra outputs as you need.
 out vec3 worldPos;
 out vec3 worldNormal;
+out vec3 diffuseColor;
+
+vec3 decodeNormal(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 void main()
 {
     // OpenGL maintains the D matrix so you only need to multiply by P, V (aka C inverse), and M
-    gl_Position = projection * view * transform * model * vec4(position, 1.0);
-    worldPos = vec3(transform * model * vec4(position, 1.0));
-    worldNormal = normalize(vec3(transpose(inverse(transform * model)) * vec4(normal, 0.0)));
+    // instanceTransform already combines the scene graph transform with the model matrix
+    gl_Position = projection * view * instanceTransform * vec4(position, 1.0);
+    worldPos = vec3(instanceTransform * vec4(position, 1.0));
+    worldNormal = normalize(vec3(transpose(inverse(instanceTransform)) * vec4(decodeNormal(normal), 0.0)));
+    diffuseColor = instanceDiffuse;
 }